@@ -0,0 +1,463 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The GNOME Power Manager authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <math.h>
+#include <string.h>
+#include <glib.h>
+
+#include "egg-graph-series.h"
+
+/* the x values seen so far, which decides if the range can be searched */
+#define EGG_GRAPH_SERIES_ORDER_NONE		0
+#define EGG_GRAPH_SERIES_ORDER_ASCENDING	1
+#define EGG_GRAPH_SERIES_ORDER_DESCENDING	2
+#define EGG_GRAPH_SERIES_ORDER_UNSORTED		3
+
+/* each level of detail merges blocks of this many points of the one below */
+#define EGG_GRAPH_SERIES_LOD_BLOCK		16
+#define EGG_GRAPH_SERIES_LOD_MIN_POINTS		64
+
+/**
+ * egg_graph_series_sized_new:
+ * @reserved_size: number of points to allocate room for
+ *
+ * Creates a new empty series with room for @reserved_size points, so that
+ * appending that many points does not allocate.
+ * Free with egg_graph_series_unref();
+ **/
+EggGraphSeries *
+egg_graph_series_sized_new (guint reserved_size)
+{
+	EggGraphSeries *series;
+	series = g_new0 (EggGraphSeries, 1);
+	series->ref_count = 1;
+	egg_graph_series_reserve (series, reserved_size);
+	return series;
+}
+
+EggGraphSeries *
+egg_graph_series_new (void)
+{
+	return egg_graph_series_sized_new (0);
+}
+
+/**
+ * egg_graph_series_new_from_points:
+ * @points: an array of EggGraphPoint's
+ *
+ * Creates a new series with a copy of the points.
+ **/
+EggGraphSeries *
+egg_graph_series_new_from_points (GPtrArray *points)
+{
+	EggGraphSeries *series;
+	EggGraphPoint *point;
+	guint i;
+
+	series = egg_graph_series_sized_new (points->len);
+	for (i = 0; i < points->len; i++) {
+		point = g_ptr_array_index (points, i);
+		egg_graph_series_append (series, point->x, point->y, point->color);
+	}
+	return series;
+}
+
+EggGraphSeries *
+egg_graph_series_copy (const EggGraphSeries *series)
+{
+	EggGraphSeries *copy;
+	copy = egg_graph_series_sized_new (series->len);
+	if (series->len > 0) {
+		memcpy (copy->x, series->x, series->len * sizeof (gdouble));
+		memcpy (copy->y, series->y, series->len * sizeof (gdouble));
+		memcpy (copy->color, series->color, series->len * sizeof (guint32));
+	}
+	copy->len = series->len;
+	copy->min_x = series->min_x;
+	copy->max_x = series->max_x;
+	copy->min_y = series->min_y;
+	copy->max_y = series->max_y;
+	copy->order = series->order;
+	return copy;
+}
+
+EggGraphSeries *
+egg_graph_series_ref (EggGraphSeries *series)
+{
+	g_return_val_if_fail (series != NULL, NULL);
+	g_atomic_int_inc (&series->ref_count);
+	return series;
+}
+
+void
+egg_graph_series_unref (EggGraphSeries *series)
+{
+	if (series == NULL)
+		return;
+	if (!g_atomic_int_dec_and_test (&series->ref_count))
+		return;
+	g_free (series->x);
+	g_free (series->y);
+	g_free (series->color);
+	if (series->lod != NULL)
+		g_ptr_array_unref (series->lod);
+	g_free (series);
+}
+
+/**
+ * egg_graph_series_reserve:
+ * @series: a #EggGraphSeries
+ * @size: number of points to allocate room for
+ *
+ * Makes sure the series can hold @size points without allocating.
+ **/
+void
+egg_graph_series_reserve (EggGraphSeries *series, guint size)
+{
+	if (size <= series->size)
+		return;
+	series->x = g_renew (gdouble, series->x, size);
+	series->y = g_renew (gdouble, series->y, size);
+	series->color = g_renew (guint32, series->color, size);
+	series->size = size;
+}
+
+void
+egg_graph_series_append (EggGraphSeries *series,
+			 gdouble x, gdouble y, guint32 color)
+{
+	/* grow geometrically */
+	if (series->len == series->size)
+		egg_graph_series_reserve (series, MAX (series->size * 2, 16));
+	series->x[series->len] = x;
+	series->y[series->len] = y;
+	series->color[series->len] = color;
+
+	/* the levels of detail no longer cover all the points */
+	g_clear_pointer (&series->lod, g_ptr_array_unref);
+
+	/* keep the bounds so the graph never has to scan for them */
+	if (series->len == 0) {
+		series->min_x = series->max_x = x;
+		series->min_y = series->max_y = y;
+		series->order = EGG_GRAPH_SERIES_ORDER_NONE;
+	} else {
+		gdouble prev = series->x[series->len - 1];
+		if (x > prev) {
+			if (series->order == EGG_GRAPH_SERIES_ORDER_NONE)
+				series->order = EGG_GRAPH_SERIES_ORDER_ASCENDING;
+			else if (series->order == EGG_GRAPH_SERIES_ORDER_DESCENDING)
+				series->order = EGG_GRAPH_SERIES_ORDER_UNSORTED;
+		} else if (x < prev) {
+			if (series->order == EGG_GRAPH_SERIES_ORDER_NONE)
+				series->order = EGG_GRAPH_SERIES_ORDER_DESCENDING;
+			else if (series->order == EGG_GRAPH_SERIES_ORDER_ASCENDING)
+				series->order = EGG_GRAPH_SERIES_ORDER_UNSORTED;
+		}
+		if (x < series->min_x)
+			series->min_x = x;
+		if (x > series->max_x)
+			series->max_x = x;
+		if (y < series->min_y)
+			series->min_y = y;
+		if (y > series->max_y)
+			series->max_y = y;
+	}
+	series->len++;
+}
+
+void
+egg_graph_series_get_point (const EggGraphSeries *series,
+			    guint idx, EggGraphPoint *point)
+{
+	g_return_if_fail (idx < series->len);
+	point->x = series->x[idx];
+	point->y = series->y[idx];
+	point->color = series->color[idx];
+}
+
+static void
+egg_graph_series_decimate_flush (const EggGraphSeries *series,
+				 EggGraphSeries *result,
+				 guint first, guint min, guint max, guint last)
+{
+	guint idx[4] = { first, MIN (min, max), MAX (min, max), last };
+	guint i;
+
+	/* in the order they were sampled, and each only once */
+	for (i = 0; i < 4; i++) {
+		if (i > 0 && idx[i] == idx[i - 1])
+			continue;
+		egg_graph_series_append (result,
+					 series->x[idx[i]],
+					 series->y[idx[i]],
+					 series->color[idx[i]]);
+	}
+}
+
+/* collapses runs of the same color in the same bucket, where a bucket is
+ * either a block of points or, when block is zero, a pixel column */
+static EggGraphSeries *
+egg_graph_series_decimate_internal (const EggGraphSeries *series,
+				    guint first_idx, guint end_idx, guint block,
+				    gdouble start_x, gdouble stop_x, gdouble unit_x)
+{
+	EggGraphSeries *result;
+	gboolean in_range = TRUE;
+	gboolean bucket_in_range = TRUE;
+	gint64 column;
+	gint64 bucket_column = 0;
+	guint first = 0, min = 0, max = 0;
+	guint i;
+
+	result = egg_graph_series_new ();
+	if (first_idx >= end_idx)
+		return result;
+
+	for (i = first_idx; i < end_idx; i++) {
+		if (block > 0) {
+			column = i / block;
+		} else {
+			in_range = series->x[i] >= start_x && series->x[i] <= stop_x;
+			column = (gint64) floor ((series->x[i] - start_x) * unit_x);
+		}
+
+		/* still in the same bucket */
+		if (i > first_idx &&
+		    column == bucket_column &&
+		    in_range == bucket_in_range &&
+		    series->color[i] == series->color[first]) {
+			if (series->y[i] < series->y[min])
+				min = i;
+			if (series->y[i] > series->y[max])
+				max = i;
+			continue;
+		}
+
+		/* start a new one */
+		if (i > first_idx)
+			egg_graph_series_decimate_flush (series, result, first, min, max, i - 1);
+		first = min = max = i;
+		bucket_column = column;
+		bucket_in_range = in_range;
+	}
+	egg_graph_series_decimate_flush (series, result, first, min, max, end_idx - 1);
+	return result;
+}
+
+/**
+ * egg_graph_series_decimate:
+ * @series: a #EggGraphSeries
+ * @start_x: the lowest X value that is drawn
+ * @stop_x: the highest X value that is drawn
+ * @unit_x: the number of pixels per X unit
+ *
+ * Collapses each run of points that have the same color and fall into the
+ * same pixel column into the first, lowest, highest and last of them. A
+ * line drawn through the result looks the same as one through @series,
+ * but has at most four points per column and color change.
+ *
+ * Points outside @start_x to @stop_x are never merged with points inside.
+ *
+ * Return value: a new #EggGraphSeries, free with egg_graph_series_unref()
+ **/
+EggGraphSeries *
+egg_graph_series_decimate (const EggGraphSeries *series,
+			   gdouble start_x, gdouble stop_x, gdouble unit_x)
+{
+	return egg_graph_series_decimate_internal (series, 0, series->len, 0,
+						   start_x, stop_x, unit_x);
+}
+
+/**
+ * egg_graph_series_decimate_range:
+ * @first: the index of the first point to use
+ * @end: the index after the last point to use
+ *
+ * As egg_graph_series_decimate(), but only for the points from @first up
+ * to @end.
+ **/
+EggGraphSeries *
+egg_graph_series_decimate_range (const EggGraphSeries *series,
+				 guint first, guint end,
+				 gdouble start_x, gdouble stop_x, gdouble unit_x)
+{
+	g_return_val_if_fail (end <= series->len, NULL);
+	return egg_graph_series_decimate_internal (series, first, end, 0,
+						   start_x, stop_x, unit_x);
+}
+
+/* the index of the first point past x, in the direction of the data */
+static guint
+egg_graph_series_bisect (const EggGraphSeries *series, gdouble x, gboolean inclusive)
+{
+	gboolean ascending = series->order != EGG_GRAPH_SERIES_ORDER_DESCENDING;
+	guint lo = 0;
+	guint hi = series->len;
+	guint mid;
+	gboolean before;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (ascending)
+			before = inclusive ? series->x[mid] <= x : series->x[mid] < x;
+		else
+			before = inclusive ? series->x[mid] >= x : series->x[mid] > x;
+		if (before)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/**
+ * egg_graph_series_find_range:
+ * @series: a #EggGraphSeries
+ * @start_x: the lowest X value
+ * @stop_x: the highest X value
+ * @first: (out): the index of the first point in range
+ * @end: (out): the index after the last point in range
+ *
+ * Finds the points between @start_x and @stop_x using a binary search,
+ * which needs the X values to only ever go up or only ever go down.
+ *
+ * Return value: %FALSE if the series is not sorted and so can't be searched
+ **/
+gboolean
+egg_graph_series_find_range (const EggGraphSeries *series,
+			     gdouble start_x, gdouble stop_x,
+			     guint *first, guint *end)
+{
+	if (series->order == EGG_GRAPH_SERIES_ORDER_UNSORTED)
+		return FALSE;
+	if (series->order == EGG_GRAPH_SERIES_ORDER_DESCENDING) {
+		*first = egg_graph_series_bisect (series, stop_x, FALSE);
+		*end = egg_graph_series_bisect (series, start_x, TRUE);
+	} else {
+		*first = egg_graph_series_bisect (series, start_x, FALSE);
+		*end = egg_graph_series_bisect (series, stop_x, TRUE);
+	}
+	if (*end < *first)
+		*end = *first;
+	return TRUE;
+}
+
+/**
+ * egg_graph_series_find_nearest:
+ * @series: a #EggGraphSeries
+ * @x: the X value to look for
+ * @idx: (out): the index of the nearest point
+ *
+ * Finds the point with the X value closest to @x. This is a binary search
+ * when the series is sorted, and only falls back to looking at every point
+ * when it is not.
+ *
+ * Return value: %FALSE if the series has no points
+ **/
+gboolean
+egg_graph_series_find_nearest (const EggGraphSeries *series, gdouble x, guint *idx)
+{
+	guint i;
+	guint best = 0;
+
+	if (series->len == 0)
+		return FALSE;
+
+	if (series->order == EGG_GRAPH_SERIES_ORDER_UNSORTED) {
+		for (i = 1; i < series->len; i++) {
+			if (fabs (series->x[i] - x) < fabs (series->x[best] - x))
+				best = i;
+		}
+		*idx = best;
+		return TRUE;
+	}
+
+	/* the first point past x, or the one just before it */
+	i = egg_graph_series_bisect (series, x, FALSE);
+	if (i == series->len)
+		best = series->len - 1;
+	else if (i > 0 && fabs (series->x[i - 1] - x) <= fabs (series->x[i] - x))
+		best = i - 1;
+	else
+		best = i;
+	*idx = best;
+	return TRUE;
+}
+
+/**
+ * egg_graph_series_get_lod:
+ * @series: a sorted #EggGraphSeries
+ * @start_x: the lowest X value that is drawn
+ * @stop_x: the highest X value that is drawn
+ * @points: the number of points that are wanted in that range
+ *
+ * Gets the coarsest level of detail that still has at least @points
+ * points between @start_x and @stop_x. Each level keeps the first, lowest,
+ * highest and last point of every same-colored run in a block of the level
+ * below, so the shape of the line is kept at every level.
+ *
+ * The levels are built the first time they are needed, and thrown away
+ * when a point is appended.
+ *
+ * Return value: (transfer none): @series or one of its levels of detail
+ **/
+EggGraphSeries *
+egg_graph_series_get_lod (EggGraphSeries *series,
+			  gdouble start_x, gdouble stop_x, guint points)
+{
+	EggGraphSeries *level = series;
+	EggGraphSeries *coarser;
+	guint first, end;
+	guint i;
+
+	if (!egg_graph_series_find_range (series, start_x, stop_x, &first, &end))
+		return series;
+	if (end - first <= points)
+		return series;
+
+	for (i = 0; ; i++) {
+		/* build the next level up */
+		if (series->lod == NULL)
+			series->lod = g_ptr_array_new_with_free_func ((GDestroyNotify) egg_graph_series_unref);
+		if (i == series->lod->len) {
+			if (level->len <= EGG_GRAPH_SERIES_LOD_MIN_POINTS)
+				return level;
+			coarser = egg_graph_series_decimate_internal (level, 0, level->len,
+								      EGG_GRAPH_SERIES_LOD_BLOCK,
+								      0, 0, 0);
+
+			/* too many color changes for this to help */
+			if (coarser->len > level->len / 2) {
+				egg_graph_series_unref (coarser);
+				return level;
+			}
+			g_ptr_array_add (series->lod, coarser);
+		}
+		coarser = g_ptr_array_index (series->lod, i);
+
+		/* this would have too few points to draw from */
+		egg_graph_series_find_range (coarser, start_x, stop_x, &first, &end);
+		if (end - first < points)
+			return level;
+		level = coarser;
+	}
+}
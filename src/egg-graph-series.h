@@ -0,0 +1,92 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The GNOME Power Manager authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __EGG_GRAPH_SERIES_H__
+#define __EGG_GRAPH_SERIES_H__
+
+#include <glib.h>
+
+#include "egg-graph-point.h"
+
+G_BEGIN_DECLS
+
+/* the points of one plot, stored as contiguous columns, along with the
+ * bounds of the data which are only valid when len is not zero */
+typedef struct
+{
+	gdouble		*x;
+	gdouble		*y;
+	guint32		*color;
+	guint		 len;
+	gdouble		 min_x;
+	gdouble		 max_x;
+	gdouble		 min_y;
+	gdouble		 max_y;
+	/*< private >*/
+	guint		 size;
+	gint		 ref_count;
+	gint		 order;
+	GPtrArray	*lod;
+} EggGraphSeries;
+
+EggGraphSeries	*egg_graph_series_new		(void);
+EggGraphSeries	*egg_graph_series_sized_new	(guint			 reserved_size);
+EggGraphSeries	*egg_graph_series_new_from_points (GPtrArray		*points);
+EggGraphSeries	*egg_graph_series_copy		(const EggGraphSeries	*series);
+EggGraphSeries	*egg_graph_series_ref		(EggGraphSeries		*series);
+void		 egg_graph_series_unref		(EggGraphSeries		*series);
+void		 egg_graph_series_reserve	(EggGraphSeries		*series,
+						 guint			 size);
+void		 egg_graph_series_append	(EggGraphSeries		*series,
+						 gdouble		 x,
+						 gdouble		 y,
+						 guint32		 color);
+void		 egg_graph_series_get_point	(const EggGraphSeries	*series,
+						 guint			 idx,
+						 EggGraphPoint		*point);
+EggGraphSeries	*egg_graph_series_decimate	(const EggGraphSeries	*series,
+						 gdouble		 start_x,
+						 gdouble		 stop_x,
+						 gdouble		 unit_x);
+EggGraphSeries	*egg_graph_series_decimate_range (const EggGraphSeries	*series,
+						 guint			 first,
+						 guint			 end,
+						 gdouble		 start_x,
+						 gdouble		 stop_x,
+						 gdouble		 unit_x);
+gboolean	 egg_graph_series_find_range	(const EggGraphSeries	*series,
+						 gdouble		 start_x,
+						 gdouble		 stop_x,
+						 guint			*first,
+						 guint			*end);
+gboolean	 egg_graph_series_find_nearest	(const EggGraphSeries	*series,
+						 gdouble		 x,
+						 guint			*idx);
+EggGraphSeries	*egg_graph_series_get_lod	(EggGraphSeries		*series,
+						 gdouble		 start_x,
+						 gdouble		 stop_x,
+						 guint			 points);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (EggGraphSeries, egg_graph_series_unref)
+
+G_END_DECLS
+
+#endif /* __EGG_GRAPH_SERIES_H__ */
@@ -29,10 +29,28 @@
 #include <cairo-svg.h>
 
 #include "egg-graph-point.h"
+#include "egg-graph-series.h"
 #include "egg-graph-widget.h"
 
 #define EGG_GRAPH_WIDGET_FONT "Sans 8"
 
+/* the most the view can be zoomed in, as a fraction of the whole range */
+#define EGG_GRAPH_WIDGET_ZOOM_MAX		1000
+/* how far a single scroll step zooms */
+#define EGG_GRAPH_WIDGET_ZOOM_STEP		1.25
+/* drags shorter than this are clicks, not a selection */
+#define EGG_GRAPH_WIDGET_SELECT_MIN_PIXELS	4
+
+/* forget all the axis labels once this many have been laid out */
+#define EGG_GRAPH_WIDGET_LABEL_CACHE_MAX	256
+
+/* only decimate lines with more points than this per pixel column */
+#define EGG_GRAPH_WIDGET_DECIMATE_POINTS_PER_COLUMN	4
+
+/* a guess at the SVG for the box, grid and labels, and for each point */
+#define EGG_GRAPH_WIDGET_SVG_BASE_SIZE		(64 * 1024)
+#define EGG_GRAPH_WIDGET_SVG_POINT_SIZE		24
+
 typedef struct {
 	gboolean		 use_grid;
 	gboolean		 use_legend;
@@ -50,6 +68,11 @@ typedef struct {
 
 	guint			 divs_x; /* number of divisions */
 
+	gint			 legend_x;
+	gint			 legend_y;
+	guint			 legend_width;
+	guint			 legend_height;
+
 	gdouble			 unit_x; /* box pixels per x unit */
 	gdouble			 unit_y; /* box pixels per y unit */
 
@@ -58,18 +81,50 @@ typedef struct {
 	gchar			*title;
 
 	PangoLayout 		*layout;
+	GHashTable		*label_cache;
 
 	GPtrArray		*data_list;
 	GPtrArray		*plot_list;
 	GPtrArray		*legend_list;
+
+	/* zooming and panning, where start_x and stop_x are the view */
+	gboolean		 zoomed;
+	gdouble			 home_start_x; /* the range when not zoomed */
+	gdouble			 home_stop_x;
+	gboolean		 selecting;
+	gdouble			 select_start; /* in widget pixels */
+	gdouble			 select_stop;
+	gdouble			 pan_start_x; /* the view when the pan began */
+	gdouble			 pan_stop_x;
+
+	/* the sample nearest the pointer */
+	gboolean		 hover_valid;
+	guint			 hover_series;
+	guint			 hover_idx;
+
+	/* box, grid, labels and legend, which only change with the layout */
+	GskRenderNode		*static_node;
+	gint			 static_width;
+	gint			 static_height;
+	gdouble			 static_start_x;
+	gdouble			 static_stop_x;
+	gdouble			 static_start_y;
+	gdouble			 static_stop_y;
+
+	/* the plotted data, which is also dropped when the data changes */
+	GskRenderNode		*data_node;
 } EggGraphWidgetPrivate;
 
 G_DEFINE_TYPE_WITH_PRIVATE (EggGraphWidget, egg_graph_widget, GTK_TYPE_DRAWING_AREA);
 #define GET_PRIVATE(o) (egg_graph_widget_get_instance_private (o))
 
-static gboolean egg_graph_widget_draw (GtkWidget *widget, cairo_t *cr);
+static void	egg_graph_widget_draw (EggGraphWidget *graph, cairo_t *cr, gint width, gint height);
 static void	egg_graph_widget_snapshot (GtkWidget* widget, GtkSnapshot* snapshot);
 static void	egg_graph_widget_finalize (GObject *object);
+static void	egg_graph_widget_get_pos_on_graph (EggGraphWidget *graph,
+						   gdouble data_x, gdouble data_y,
+						   gdouble *x, gdouble *y);
+static gchar	*egg_graph_widget_get_axis_label (EggGraphWidgetKind axis, gdouble value);
 
 enum
 {
@@ -85,6 +140,7 @@ enum
 	PROP_START_Y,
 	PROP_STOP_X,
 	PROP_STOP_Y,
+	PROP_ZOOMED,
 	PROP_LAST
 };
 
@@ -100,6 +156,64 @@ egg_graph_widget_key_legend_data_free (EggGraphWidgetLegendData *legend_data)
 	g_free (legend_data);
 }
 
+typedef struct {
+	EggGraphWidgetKind	 kind;
+	gdouble			 value;
+} EggGraphWidgetLabelKey;
+
+/* a formatted and laid out axis label */
+typedef struct {
+	EggGraphWidgetLabelKey	 key;
+	PangoLayout		*layout;
+	PangoRectangle		 ink_rect;
+} EggGraphWidgetLabel;
+
+static void
+egg_graph_widget_label_free (EggGraphWidgetLabel *label)
+{
+	g_object_unref (label->layout);
+	g_free (label);
+}
+
+static guint
+egg_graph_widget_label_key_hash (gconstpointer key)
+{
+	const EggGraphWidgetLabelKey *k = key;
+	return g_double_hash (&k->value) ^ k->kind;
+}
+
+static gboolean
+egg_graph_widget_label_key_equal (gconstpointer a, gconstpointer b)
+{
+	const EggGraphWidgetLabelKey *k1 = a;
+	const EggGraphWidgetLabelKey *k2 = b;
+	return k1->kind == k2->kind && k1->value == k2->value;
+}
+
+static void
+egg_graph_widget_invalidate_data (EggGraphWidget *graph)
+{
+	EggGraphWidgetPrivate *priv = GET_PRIVATE (graph);
+	g_clear_pointer (&priv->data_node, gsk_render_node_unref);
+}
+
+/* the data is drawn using the same layout, so goes too */
+static void
+egg_graph_widget_invalidate_static (EggGraphWidget *graph)
+{
+	EggGraphWidgetPrivate *priv = GET_PRIVATE (graph);
+	g_clear_pointer (&priv->static_node, gsk_render_node_unref);
+	egg_graph_widget_invalidate_data (graph);
+}
+
+static void
+egg_graph_widget_invalidate_labels (EggGraphWidget *graph)
+{
+	EggGraphWidgetPrivate *priv = GET_PRIVATE (graph);
+	g_hash_table_remove_all (priv->label_cache);
+	egg_graph_widget_invalidate_static (graph);
+}
+
 void
 egg_graph_widget_key_legend_add (EggGraphWidget *graph, guint32 color, const gchar *desc)
 {
@@ -113,6 +227,7 @@ egg_graph_widget_key_legend_add (EggGraphWidget *graph, guint32 color, const gch
 	legend_data->color = color;
 	legend_data->desc = g_strdup (desc);
 	g_ptr_array_add (priv->legend_list, legend_data);
+	egg_graph_widget_invalidate_static (graph);
 }
 
 void
@@ -121,6 +236,7 @@ egg_graph_widget_key_legend_clear (EggGraphWidget *graph)
 	EggGraphWidgetPrivate *priv = GET_PRIVATE (graph);
 	g_return_if_fail (EGG_IS_GRAPH_WIDGET (graph));
 	g_ptr_array_set_size (priv->legend_list, 0);
+	egg_graph_widget_invalidate_static (graph);
 }
 
 void
@@ -128,6 +244,7 @@ egg_graph_widget_set_use_legend (EggGraphWidget *graph, gboolean use_legend)
 {
 	EggGraphWidgetPrivate *priv = GET_PRIVATE (graph);
 	priv->use_legend = use_legend;
+	egg_graph_widget_invalidate_static (graph);
 }
 
 gboolean
@@ -137,6 +254,354 @@ egg_graph_widget_get_use_legend (EggGraphWidget *graph)
 	return priv->use_legend;
 }
 
+/**
+ * egg_graph_widget_get_zoomed:
+ * @graph: This class instance
+ *
+ * Return value: %TRUE if the user has zoomed into part of the range
+ **/
+gboolean
+egg_graph_widget_get_zoomed (EggGraphWidget *graph)
+{
+	EggGraphWidgetPrivate *priv = GET_PRIVATE (graph);
+	g_return_val_if_fail (EGG_IS_GRAPH_WIDGET (graph), FALSE);
+	return priv->zoomed;
+}
+
+static void
+egg_graph_widget_set_zoomed (EggGraphWidget *graph, gboolean zoomed)
+{
+	EggGraphWidgetPrivate *priv = GET_PRIVATE (graph);
+	if (priv->zoomed == zoomed)
+		return;
+	priv->zoomed = zoomed;
+	g_object_notify (G_OBJECT (graph), "zoomed");
+}
+
+/* a range set by the application only resets the zoom if it has moved */
+static void
+egg_graph_widget_set_range_x (EggGraphWidget *graph, gdouble start_x, gdouble stop_x)
+{
+	EggGraphWidgetPrivate *priv = GET_PRIVATE (graph);
+	if (priv->zoomed && start_x == priv->home_start_x && stop_x == priv->home_stop_x)
+		return;
+	priv->start_x = start_x;
+	priv->stop_x = stop_x;
+	egg_graph_widget_set_zoomed (graph, FALSE);
+}
+
+/**
+ * egg_graph_widget_zoom_reset:
+ * @graph: This class instance
+ *
+ * Shows the whole range again after the user has zoomed in.
+ **/
+void
+egg_graph_widget_zoom_reset (EggGraphWidget *graph)
+{
+	EggGraphWidgetPrivate *priv = GET_PRIVATE (graph);
+	g_return_if_fail (EGG_IS_GRAPH_WIDGET (graph));
+	if (!priv->zoomed)
+		return;
+	priv->start_x = priv->home_start_x;
+	priv->stop_x = priv->home_stop_x;
+	egg_graph_widget_set_zoomed (graph, FALSE);
+	gtk_widget_queue_draw (GTK_WIDGET (graph));
+}
+
+/* shows start_x to stop_x, kept inside the whole range */
+static void
+egg_graph_widget_zoom_to (EggGraphWidget *graph, gdouble start_x, gdouble stop_x)
+{
+	EggGraphWidgetPrivate *priv = GET_PRIVATE (graph);
+	gdouble home_span;
+	gdouble min_span;
+	gdouble center;
+
+	if (!priv->zoomed) {
+		priv->home_start_x = priv->start_x;
+		priv->home_stop_x = priv->stop_x;
+	}
+	home_span = priv->home_stop_x - priv->home_start_x;
+
+	/* zoomed right out */
+	if (stop_x - start_x >= home_span) {
+		egg_graph_widget_zoom_reset (graph);
+		return;
+	}
+
+	/* zoomed too far in */
+	min_span = home_span / EGG_GRAPH_WIDGET_ZOOM_MAX;
+	if (stop_x - start_x < min_span) {
+		center = (start_x + stop_x) / 2;
+		start_x = center - min_span / 2;
+		stop_x = center + min_span / 2;
+	}
+
+	/* don't pan past the ends */
+	if (start_x < priv->home_start_x) {
+		stop_x += priv->home_start_x - start_x;
+		start_x = priv->home_start_x;
+	}
+	if (stop_x > priv->home_stop_x) {
+		start_x -= stop_x - priv->home_stop_x;
+		stop_x = priv->home_stop_x;
+	}
+
+	priv->start_x = start_x;
+	priv->stop_x = stop_x;
+	egg_graph_widget_set_zoomed (graph, TRUE);
+	gtk_widget_queue_draw (GTK_WIDGET (graph));
+}
+
+/**
+ * egg_graph_widget_zoom_shift:
+ * @graph: This class instance
+ * @offset: How far the X values of the same samples have moved
+ *
+ * Keeps a zoomed view on the same samples when the X values are relative
+ * to something that moves between updates, such as the current time.
+ **/
+void
+egg_graph_widget_zoom_shift (EggGraphWidget *graph, gdouble offset)
+{
+	EggGraphWidgetPrivate *priv = GET_PRIVATE (graph);
+	g_return_if_fail (EGG_IS_GRAPH_WIDGET (graph));
+	if (!priv->zoomed || offset == 0)
+		return;
+	egg_graph_widget_zoom_to (graph, priv->start_x + offset, priv->stop_x + offset);
+}
+
+/* the X value under a widget pixel, using the last layout */
+static gdouble
+egg_graph_widget_get_data_x (EggGraphWidget *graph, gdouble x)
+{
+	EggGraphWidgetPrivate *priv = GET_PRIVATE (graph);
+	return priv->start_x + (x - priv->box_x - 1) / priv->unit_x;
+}
+
+static void
+egg_graph_widget_select_begin_cb (GtkGestureDrag *gesture, gdouble x, gdouble y, EggGraphWidget *graph)
+{
+	EggGraphWidgetPrivate *priv = GET_PRIVATE (graph);
+	if (priv->unit_x <= 0) {
+		gtk_gesture_set_state (GTK_GESTURE (gesture), GTK_EVENT_SEQUENCE_DENIED);
+		return;
+	}
+	priv->selecting = TRUE;
+	priv->select_start = x;
+	priv->select_stop = x;
+}
+
+static void
+egg_graph_widget_select_update_cb (GtkGestureDrag *gesture, gdouble offset_x, gdouble offset_y, EggGraphWidget *graph)
+{
+	EggGraphWidgetPrivate *priv = GET_PRIVATE (graph);
+	gdouble box_start = priv->box_x;
+	gdouble box_stop = priv->box_x + priv->box_width;
+
+	/* the selection is only of the box */
+	priv->select_stop = CLAMP (priv->select_start + offset_x, box_start, box_stop);
+	gtk_widget_queue_draw (GTK_WIDGET (graph));
+}
+
+static void
+egg_graph_widget_select_end_cb (GtkGestureDrag *gesture, gdouble offset_x, gdouble offset_y, EggGraphWidget *graph)
+{
+	EggGraphWidgetPrivate *priv = GET_PRIVATE (graph);
+	gdouble start;
+	gdouble stop;
+
+	priv->selecting = FALSE;
+	start = MIN (priv->select_start, priv->select_stop);
+	stop = MAX (priv->select_start, priv->select_stop);
+	if (stop - start < EGG_GRAPH_WIDGET_SELECT_MIN_PIXELS) {
+		gtk_widget_queue_draw (GTK_WIDGET (graph));
+		return;
+	}
+	egg_graph_widget_zoom_to (graph,
+				  egg_graph_widget_get_data_x (graph, start),
+				  egg_graph_widget_get_data_x (graph, stop));
+}
+
+static void
+egg_graph_widget_pan_begin_cb (GtkGestureDrag *gesture, gdouble x, gdouble y, EggGraphWidget *graph)
+{
+	EggGraphWidgetPrivate *priv = GET_PRIVATE (graph);
+	if (!priv->zoomed || priv->unit_x <= 0) {
+		gtk_gesture_set_state (GTK_GESTURE (gesture), GTK_EVENT_SEQUENCE_DENIED);
+		return;
+	}
+	priv->pan_start_x = priv->start_x;
+	priv->pan_stop_x = priv->stop_x;
+}
+
+static void
+egg_graph_widget_pan_update_cb (GtkGestureDrag *gesture, gdouble offset_x, gdouble offset_y, EggGraphWidget *graph)
+{
+	EggGraphWidgetPrivate *priv = GET_PRIVATE (graph);
+	gdouble delta = offset_x / priv->unit_x;
+	egg_graph_widget_zoom_to (graph, priv->pan_start_x - delta, priv->pan_stop_x - delta);
+}
+
+static gboolean
+egg_graph_widget_scroll_cb (GtkEventControllerScroll *controller, gdouble dx, gdouble dy, EggGraphWidget *graph)
+{
+	EggGraphWidgetPrivate *priv = GET_PRIVATE (graph);
+	GdkEvent *event;
+	gdouble x = 0, y = 0;
+	gdouble center;
+	gdouble factor;
+	gdouble span = priv->stop_x - priv->start_x;
+
+	if (priv->unit_x <= 0)
+		return FALSE;
+
+	/* sideways scrolling pans */
+	if (fabs (dx) > fabs (dy)) {
+		if (!priv->zoomed)
+			return FALSE;
+		egg_graph_widget_zoom_to (graph,
+					  priv->start_x + dx * span / 10,
+					  priv->stop_x + dx * span / 10);
+		return TRUE;
+	}
+
+	/* zoom around the pointer */
+	event = gtk_event_controller_get_current_event (GTK_EVENT_CONTROLLER (controller));
+	if (event != NULL && gdk_event_get_position (event, &x, &y))
+		center = egg_graph_widget_get_data_x (graph, x);
+	else
+		center = (priv->start_x + priv->stop_x) / 2;
+	center = CLAMP (center, priv->start_x, priv->stop_x);
+	factor = pow (EGG_GRAPH_WIDGET_ZOOM_STEP, dy);
+	egg_graph_widget_zoom_to (graph,
+				  center - (center - priv->start_x) * factor,
+				  center + (priv->stop_x - center) * factor);
+	return TRUE;
+}
+
+static void
+egg_graph_widget_pressed_cb (GtkGestureClick *gesture, gint n_press, gdouble x, gdouble y, EggGraphWidget *graph)
+{
+	if (n_press == 2)
+		egg_graph_widget_zoom_reset (graph);
+}
+
+/* finds the sample nearest to a widget pixel, checking the sample nearest
+ * in time from each series as that is a binary search */
+static gboolean
+egg_graph_widget_find_sample (EggGraphWidget *graph, gdouble x, gdouble y,
+			      guint *series_idx, guint *idx)
+{
+	EggGraphWidgetPrivate *priv = GET_PRIVATE (graph);
+	EggGraphSeries *data;
+	gdouble data_x;
+	gdouble dist;
+	gdouble best = G_MAXDOUBLE;
+	gdouble pos_x, pos_y;
+	guint i, j;
+
+	if (priv->unit_x <= 0)
+		return FALSE;
+	if (x < priv->box_x || x > priv->box_x + priv->box_width ||
+	    y < priv->box_y || y > priv->box_y + priv->box_height)
+		return FALSE;
+
+	data_x = egg_graph_widget_get_data_x (graph, x);
+	for (j = 0; j < priv->data_list->len; j++) {
+		data = g_ptr_array_index (priv->data_list, j);
+		if (!egg_graph_series_find_nearest (data, data_x, &i))
+			continue;
+		if (data->x[i] < priv->start_x || data->x[i] > priv->stop_x)
+			continue;
+		egg_graph_widget_get_pos_on_graph (graph, data->x[i], data->y[i], &pos_x, &pos_y);
+		dist = (pos_x - x) * (pos_x - x) + (pos_y - y) * (pos_y - y);
+		if (dist < best) {
+			best = dist;
+			*series_idx = j;
+			*idx = i;
+		}
+	}
+	return best < G_MAXDOUBLE;
+}
+
+static void
+egg_graph_widget_set_hover (EggGraphWidget *graph, gboolean valid, guint series_idx, guint idx)
+{
+	EggGraphWidgetPrivate *priv = GET_PRIVATE (graph);
+
+	/* still on the same sample */
+	if (valid == priv->hover_valid &&
+	    (!valid || (series_idx == priv->hover_series && idx == priv->hover_idx)))
+		return;
+	priv->hover_valid = valid;
+	priv->hover_series = series_idx;
+	priv->hover_idx = idx;
+	gtk_widget_queue_draw (GTK_WIDGET (graph));
+	gtk_widget_trigger_tooltip_query (GTK_WIDGET (graph));
+}
+
+static void
+egg_graph_widget_motion_cb (GtkEventControllerMotion *controller, gdouble x, gdouble y, EggGraphWidget *graph)
+{
+	guint series_idx = 0;
+	guint idx = 0;
+	gboolean valid;
+
+	valid = egg_graph_widget_find_sample (graph, x, y, &series_idx, &idx);
+	egg_graph_widget_set_hover (graph, valid, series_idx, idx);
+}
+
+static void
+egg_graph_widget_leave_cb (GtkEventControllerMotion *controller, EggGraphWidget *graph)
+{
+	egg_graph_widget_set_hover (graph, FALSE, 0, 0);
+}
+
+static const gchar *
+egg_graph_widget_get_legend_desc (EggGraphWidget *graph, guint32 color)
+{
+	EggGraphWidgetPrivate *priv = GET_PRIVATE (graph);
+	EggGraphWidgetLegendData *legend_data;
+	guint i;
+
+	for (i = 0; i < priv->legend_list->len; i++) {
+		legend_data = g_ptr_array_index (priv->legend_list, i);
+		if (legend_data->color == color)
+			return legend_data->desc;
+	}
+	return NULL;
+}
+
+static gboolean
+egg_graph_widget_query_tooltip (GtkWidget *widget, gint x, gint y,
+				gboolean keyboard_mode, GtkTooltip *tooltip)
+{
+	EggGraphWidget *graph = EGG_GRAPH_WIDGET (widget);
+	EggGraphWidgetPrivate *priv = GET_PRIVATE (graph);
+	EggGraphSeries *data;
+	const gchar *desc;
+	g_autofree gchar *text = NULL;
+	g_autofree gchar *text_x = NULL;
+	g_autofree gchar *text_y = NULL;
+
+	if (!priv->hover_valid)
+		return FALSE;
+
+	/* time, value and the state the color stands for */
+	data = g_ptr_array_index (priv->data_list, priv->hover_series);
+	text_x = egg_graph_widget_get_axis_label (priv->type_x, data->x[priv->hover_idx]);
+	text_y = egg_graph_widget_get_axis_label (priv->type_y, data->y[priv->hover_idx]);
+	desc = egg_graph_widget_get_legend_desc (graph, data->color[priv->hover_idx]);
+	if (desc != NULL)
+		text = g_strdup_printf ("%s\n%s\n%s", text_x, text_y, desc);
+	else
+		text = g_strdup_printf ("%s\n%s", text_x, text_y);
+	gtk_tooltip_set_text (tooltip, text);
+	return TRUE;
+}
+
 static void
 up_graph_get_property (GObject *object, guint prop_id, GValue *value, GParamSpec *pspec)
 {
@@ -165,17 +630,20 @@ up_graph_get_property (GObject *object, guint prop_id, GValue *value, GParamSpec
 		g_value_set_uint (value, priv->divs_x);
 		break;
 	case PROP_START_X:
-		g_value_set_double (value, priv->start_x);
+		g_value_set_double (value, priv->zoomed ? priv->home_start_x : priv->start_x);
 		break;
 	case PROP_START_Y:
 		g_value_set_double (value, priv->start_y);
 		break;
 	case PROP_STOP_X:
-		g_value_set_double (value, priv->stop_x);
+		g_value_set_double (value, priv->zoomed ? priv->home_stop_x : priv->stop_x);
 		break;
 	case PROP_STOP_Y:
 		g_value_set_double (value, priv->stop_y);
 		break;
+	case PROP_ZOOMED:
+		g_value_set_boolean (value, priv->zoomed);
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 		break;
@@ -211,13 +679,16 @@ up_graph_set_property (GObject *object, guint prop_id, const GValue *value, GPar
 		priv->divs_x = g_value_get_uint (value);
 		break;
 	case PROP_START_X:
-		priv->start_x = g_value_get_double (value);
+		egg_graph_widget_set_range_x (graph, g_value_get_double (value),
+					      priv->zoomed ? priv->home_stop_x : priv->stop_x);
 		break;
 	case PROP_START_Y:
 		priv->start_y = g_value_get_double (value);
 		break;
 	case PROP_STOP_X:
-		priv->stop_x = g_value_get_double (value);
+		egg_graph_widget_set_range_x (graph,
+					      priv->zoomed ? priv->home_start_x : priv->start_x,
+					      g_value_get_double (value));
 		break;
 	case PROP_STOP_Y:
 		priv->stop_y = g_value_get_double (value);
@@ -228,9 +699,26 @@ up_graph_set_property (GObject *object, guint prop_id, const GValue *value, GPar
 	}
 
 	/* refresh widget */
+	egg_graph_widget_invalidate_static (graph);
 	gtk_widget_queue_draw (GTK_WIDGET (graph));
 }
 
+static void
+egg_graph_widget_css_changed (GtkWidget *widget, GtkCssStyleChange *change)
+{
+	/* the label color or font may have changed */
+	egg_graph_widget_invalidate_labels (EGG_GRAPH_WIDGET (widget));
+	GTK_WIDGET_CLASS (egg_graph_widget_parent_class)->css_changed (widget, change);
+}
+
+static void
+egg_graph_widget_system_setting_changed (GtkWidget *widget, GtkSystemSetting setting)
+{
+	/* the font or its rendering may have changed */
+	egg_graph_widget_invalidate_labels (EGG_GRAPH_WIDGET (widget));
+	GTK_WIDGET_CLASS (egg_graph_widget_parent_class)->system_setting_changed (widget, setting);
+}
+
 static void
 egg_graph_widget_class_init (EggGraphWidgetClass *class)
 {
@@ -238,6 +726,9 @@ egg_graph_widget_class_init (EggGraphWidgetClass *class)
 	GObjectClass *object_class = G_OBJECT_CLASS (class);
 
 	widget_class->snapshot = egg_graph_widget_snapshot;
+	widget_class->query_tooltip = egg_graph_widget_query_tooltip;
+	widget_class->css_changed = egg_graph_widget_css_changed;
+	widget_class->system_setting_changed = egg_graph_widget_system_setting_changed;
 	object_class->get_property = up_graph_get_property;
 	object_class->set_property = up_graph_set_property;
 	object_class->finalize = egg_graph_widget_finalize;
@@ -302,11 +793,18 @@ egg_graph_widget_class_init (EggGraphWidgetClass *class)
 					 g_param_spec_double ("stop-y", NULL, NULL,
 							   -G_MAXDOUBLE, G_MAXDOUBLE, 100.f,
 							   G_PARAM_READWRITE));
+	g_object_class_install_property (object_class,
+					 PROP_ZOOMED,
+					 g_param_spec_boolean ("zoomed", NULL, NULL,
+							       FALSE,
+							       G_PARAM_READABLE));
 }
 
 static void
 egg_graph_widget_init (EggGraphWidget *graph)
 {
+	GtkGesture *gesture;
+	GtkEventController *controller;
 	PangoContext *context;
 	PangoFontDescription *desc;
 	EggGraphWidgetPrivate *priv = GET_PRIVATE (graph);
@@ -319,19 +817,68 @@ egg_graph_widget_init (EggGraphWidget *graph)
 	priv->use_grid = TRUE;
 	priv->use_legend = FALSE;
 	priv->legend_list = g_ptr_array_new_with_free_func ((GDestroyNotify) egg_graph_widget_key_legend_data_free);
-	priv->data_list = g_ptr_array_new_with_free_func ((GDestroyNotify) g_ptr_array_unref);
+	priv->data_list = g_ptr_array_new_with_free_func ((GDestroyNotify) egg_graph_series_unref);
 	priv->plot_list = g_ptr_array_new ();
+	priv->label_cache = g_hash_table_new_full (egg_graph_widget_label_key_hash,
+						   egg_graph_widget_label_key_equal,
+						   NULL,
+						   (GDestroyNotify) egg_graph_widget_label_free);
 	priv->type_x = EGG_GRAPH_WIDGET_KIND_TIME;
 	priv->type_y = EGG_GRAPH_WIDGET_KIND_PERCENTAGE;
 
 	gtk_widget_set_hexpand (GTK_WIDGET (graph), TRUE);
 	gtk_widget_set_vexpand (GTK_WIDGET (graph), TRUE);
 
-	/* do pango stuff */
-	context = gtk_widget_get_pango_context (GTK_WIDGET (graph));
+	/* drag to zoom into a range, and double click to zoom out again */
+	gesture = gtk_gesture_drag_new ();
+	gtk_gesture_single_set_button (GTK_GESTURE_SINGLE (gesture), GDK_BUTTON_PRIMARY);
+	g_signal_connect (gesture, "drag-begin",
+			  G_CALLBACK (egg_graph_widget_select_begin_cb), graph);
+	g_signal_connect (gesture, "drag-update",
+			  G_CALLBACK (egg_graph_widget_select_update_cb), graph);
+	g_signal_connect (gesture, "drag-end",
+			  G_CALLBACK (egg_graph_widget_select_end_cb), graph);
+	gtk_widget_add_controller (GTK_WIDGET (graph), GTK_EVENT_CONTROLLER (gesture));
+	gesture = gtk_gesture_click_new ();
+	g_signal_connect (gesture, "pressed",
+			  G_CALLBACK (egg_graph_widget_pressed_cb), graph);
+	gtk_widget_add_controller (GTK_WIDGET (graph), GTK_EVENT_CONTROLLER (gesture));
+
+	/* drag with the middle button to pan */
+	gesture = gtk_gesture_drag_new ();
+	gtk_gesture_single_set_button (GTK_GESTURE_SINGLE (gesture), GDK_BUTTON_MIDDLE);
+	g_signal_connect (gesture, "drag-begin",
+			  G_CALLBACK (egg_graph_widget_pan_begin_cb), graph);
+	g_signal_connect (gesture, "drag-update",
+			  G_CALLBACK (egg_graph_widget_pan_update_cb), graph);
+	gtk_widget_add_controller (GTK_WIDGET (graph), GTK_EVENT_CONTROLLER (gesture));
+
+	/* scroll to zoom, or sideways to pan */
+	controller = gtk_event_controller_scroll_new (GTK_EVENT_CONTROLLER_SCROLL_BOTH_AXES);
+	g_signal_connect (controller, "scroll",
+			  G_CALLBACK (egg_graph_widget_scroll_cb), graph);
+	gtk_widget_add_controller (GTK_WIDGET (graph), controller);
+
+	/* show the sample under the pointer */
+	controller = gtk_event_controller_motion_new ();
+	g_signal_connect (controller, "motion",
+			  G_CALLBACK (egg_graph_widget_motion_cb), graph);
+	g_signal_connect (controller, "leave",
+			  G_CALLBACK (egg_graph_widget_leave_cb), graph);
+	gtk_widget_add_controller (GTK_WIDGET (graph), controller);
+	gtk_widget_set_has_tooltip (GTK_WIDGET (graph), TRUE);
+
+	/* do pango stuff, without a display this can still export */
+	if (gdk_display_get_default () != NULL) {
+		context = g_object_ref (gtk_widget_get_pango_context (GTK_WIDGET (graph)));
+	} else {
+		context = pango_font_map_create_context (pango_cairo_font_map_get_default ());
+		pango_cairo_context_set_resolution (context, 96);
+	}
 	pango_context_set_base_gravity (context, PANGO_GRAVITY_AUTO);
 
 	priv->layout = pango_layout_new (context);
+	g_object_unref (context);
 	desc = pango_font_description_from_string (EGG_GRAPH_WIDGET_FONT);
 	pango_layout_set_font_description (priv->layout, desc);
 	pango_font_description_free (desc);
@@ -344,6 +891,8 @@ egg_graph_widget_data_clear (EggGraphWidget *graph)
 	g_return_if_fail (EGG_IS_GRAPH_WIDGET (graph));
 	g_ptr_array_set_size (priv->data_list, 0);
 	g_ptr_array_set_size (priv->plot_list, 0);
+	priv->hover_valid = FALSE;
+	egg_graph_widget_invalidate_data (graph);
 }
 
 static void
@@ -357,6 +906,9 @@ egg_graph_widget_finalize (GObject *object)
 	g_ptr_array_unref (priv->plot_list);
 
 	g_object_unref (priv->layout);
+	g_hash_table_unref (priv->label_cache);
+	g_clear_pointer (&priv->static_node, gsk_render_node_unref);
+	g_clear_pointer (&priv->data_node, gsk_render_node_unref);
 
 	G_OBJECT_CLASS (egg_graph_widget_parent_class)->finalize (object);
 }
@@ -372,23 +924,68 @@ void
 egg_graph_widget_data_add (EggGraphWidget *graph, EggGraphWidgetPlot plot, GPtrArray *data)
 {
 	EggGraphWidgetPrivate *priv = GET_PRIVATE (graph);
-	GPtrArray *copy;
-	EggGraphPoint *obj;
-	guint i;
 
 	g_return_if_fail (data != NULL);
 	g_return_if_fail (EGG_IS_GRAPH_WIDGET (graph));
 
-	/* make a deep copy */
-	copy = g_ptr_array_new_with_free_func ((GDestroyNotify) egg_graph_point_free);
-	for (i = 0; i < data->len; i++) {
-		obj = egg_graph_point_copy (g_ptr_array_index (data, i));
-		g_ptr_array_add (copy, obj);
-	}
+	/* get the new data */
+	g_ptr_array_add (priv->data_list, egg_graph_series_new_from_points (data));
+	g_ptr_array_add (priv->plot_list, GUINT_TO_POINTER(plot));
+	egg_graph_widget_invalidate_data (graph);
+
+	/* refresh */
+	gtk_widget_queue_draw (GTK_WIDGET (graph));
+}
+
+/**
+ * egg_graph_widget_data_add_series:
+ * @graph: This class instance
+ * @series: an #EggGraphSeries
+ *
+ * Sets the data for the graph from a copy of the series
+ **/
+void
+egg_graph_widget_data_add_series (EggGraphWidget *graph,
+				  EggGraphWidgetPlot plot,
+				  EggGraphSeries *series)
+{
+	EggGraphWidgetPrivate *priv = GET_PRIVATE (graph);
+
+	g_return_if_fail (series != NULL);
+	g_return_if_fail (EGG_IS_GRAPH_WIDGET (graph));
 
 	/* get the new data */
-	g_ptr_array_add (priv->data_list, copy);
+	g_ptr_array_add (priv->data_list, egg_graph_series_copy (series));
 	g_ptr_array_add (priv->plot_list, GUINT_TO_POINTER(plot));
+	egg_graph_widget_invalidate_data (graph);
+
+	/* refresh */
+	gtk_widget_queue_draw (GTK_WIDGET (graph));
+}
+
+/**
+ * egg_graph_widget_data_take:
+ * @graph: This class instance
+ * @series: (transfer full): an #EggGraphSeries
+ *
+ * Sets the data for the graph without copying, taking ownership of the
+ * reference. Pass egg_graph_series_ref() to keep using the series, but it
+ * must not be modified afterwards as the graph draws from it directly.
+ **/
+void
+egg_graph_widget_data_take (EggGraphWidget *graph,
+			    EggGraphWidgetPlot plot,
+			    EggGraphSeries *series)
+{
+	EggGraphWidgetPrivate *priv = GET_PRIVATE (graph);
+
+	g_return_if_fail (series != NULL);
+	g_return_if_fail (EGG_IS_GRAPH_WIDGET (graph));
+
+	/* get the new data */
+	g_ptr_array_add (priv->data_list, series);
+	g_ptr_array_add (priv->plot_list, GUINT_TO_POINTER(plot));
+	egg_graph_widget_invalidate_data (graph);
 
 	/* refresh */
 	gtk_widget_queue_draw (GTK_WIDGET (graph));
@@ -489,11 +1086,100 @@ egg_graph_widget_draw_grid (EggGraphWidget *graph, cairo_t *cr)
 		cairo_stroke (cr);
 	}
 
-	cairo_restore (cr);
+	cairo_restore (cr);
+}
+
+#if GTK_CHECK_VERSION(4,14,0)
+static void
+egg_graph_widget_snapshot_grid (EggGraphWidget *graph, GtkSnapshot *snapshot)
+{
+	EggGraphWidgetPrivate *priv = GET_PRIVATE (graph);
+	guint i;
+	gdouble b;
+	const gfloat dotted[] = {1.f, 2.f};
+	const GdkRGBA color = { 0.1f, 0.1f, 0.1f, 1.f };
+	gdouble divwidth  = (gdouble)priv->box_width / (gdouble)priv->divs_x;
+	gdouble divheight = (gdouble)priv->box_height / 10.0f;
+	GskPathBuilder *builder;
+	GskStroke *stroke;
+	GskPath *path;
+
+	/* all the lines are one path, and so one node */
+	builder = gsk_path_builder_new ();
+	for (i = 1; i < priv->divs_x; i++) {
+		b = priv->box_x + ((gdouble) i * divwidth);
+		gsk_path_builder_move_to (builder, (gint)b + 0.5f, priv->box_y);
+		gsk_path_builder_line_to (builder, (gint)b + 0.5f, priv->box_y + priv->box_height);
+	}
+	for (i = 1; i < 10; i++) {
+		b = priv->box_y + ((gdouble) i * divheight);
+		gsk_path_builder_move_to (builder, priv->box_x, (gint)b + 0.5f);
+		gsk_path_builder_line_to (builder, priv->box_x + priv->box_width, (gint)b + 0.5f);
+	}
+	path = gsk_path_builder_free_to_path (builder);
+
+	stroke = gsk_stroke_new (1.f);
+	gsk_stroke_set_dash (stroke, dotted, G_N_ELEMENTS (dotted));
+	gtk_snapshot_append_stroke (snapshot, path, stroke, &color);
+	gsk_stroke_free (stroke);
+	gsk_path_unref (path);
+}
+#endif
+
+/**
+ * egg_graph_widget_get_label:
+ * @graph: This class instance
+ * @kind: The axis kind
+ * @value: The value on the axis
+ *
+ * Gets the laid out text for an axis label, which is only formatted and
+ * measured the first time it is used.
+ **/
+static EggGraphWidgetLabel *
+egg_graph_widget_get_label (EggGraphWidget *graph, EggGraphWidgetKind kind, gdouble value)
+{
+	EggGraphWidgetPrivate *priv = GET_PRIVATE (graph);
+	EggGraphWidgetLabel *label;
+	EggGraphWidgetLabelKey key = { kind, value };
+	g_autofree gchar *text = NULL;
+
+	label = g_hash_table_lookup (priv->label_cache, &key);
+	if (label != NULL)
+		return label;
+
+	/* autorange can make lots of distinct values over time */
+	if (g_hash_table_size (priv->label_cache) >= EGG_GRAPH_WIDGET_LABEL_CACHE_MAX)
+		g_hash_table_remove_all (priv->label_cache);
+
+	text = egg_graph_widget_get_axis_label (kind, value);
+	label = g_new0 (EggGraphWidgetLabel, 1);
+	label->key = key;
+	label->layout = pango_layout_copy (priv->layout);
+	pango_layout_set_text (label->layout, text, -1);
+	pango_layout_get_pixel_extents (label->layout, &label->ink_rect, NULL);
+	g_hash_table_insert (priv->label_cache, &label->key, label);
+	return label;
+}
+
+/* draws the layout with its top left at x,y, in the current cairo color
+ * or in @color when building render nodes */
+static void
+egg_graph_widget_show_layout (PangoLayout *layout, cairo_t *cr, GtkSnapshot *snapshot,
+			      gdouble x, gdouble y, const GdkRGBA *color)
+{
+	if (snapshot != NULL) {
+		gtk_snapshot_save (snapshot);
+		gtk_snapshot_translate (snapshot, &GRAPHENE_POINT_INIT (x, y));
+		gtk_snapshot_append_layout (snapshot, layout, color);
+		gtk_snapshot_restore (snapshot);
+		return;
+	}
+	cairo_move_to (cr, x, y);
+	pango_cairo_show_layout (cr, layout);
 }
 
 static void
-egg_graph_widget_draw_labels (EggGraphWidget *graph, cairo_t *cr)
+egg_graph_widget_draw_labels (EggGraphWidget *graph, cairo_t *cr, GtkSnapshot *snapshot)
 {
 	EggGraphWidgetPrivate *priv = GET_PRIVATE (graph);
 	guint i;
@@ -503,64 +1189,64 @@ egg_graph_widget_draw_labels (EggGraphWidget *graph, cairo_t *cr)
 	gdouble divheight = (gdouble)priv->box_height / 10.0f;
 	gdouble length_x = priv->stop_x - priv->start_x;
 	gdouble length_y = priv->stop_y - priv->start_y;
-	PangoRectangle ink_rect, logical_rect;
+	EggGraphWidgetLabel *label;
 	gdouble offsetx = 0;
 	gdouble offsety = 0;
-	GtkStyleContext *style_context = gtk_widget_get_style_context (GTK_WIDGET (graph));
-	GdkRGBA text_color;
+	GtkStyleContext *style_context;
+	GdkRGBA text_color = { 0.f, 0.f, 0.f, 1.f };
 
-	gtk_style_context_get_color(style_context, &text_color);
+	/* there is no style when exporting without a display */
+	if (gdk_display_get_default () != NULL) {
+		style_context = gtk_widget_get_style_context (GTK_WIDGET (graph));
+		gtk_style_context_get_color (style_context, &text_color);
+	}
 
-	cairo_save (cr);
+	if (cr != NULL) {
+		cairo_save (cr);
+		cairo_set_source_rgb (cr, text_color.red, text_color.green, text_color.blue);
+	}
 
 	/* do x text */
-	cairo_set_source_rgb (cr, text_color.red, text_color.green, text_color.blue);
 	for (i = 0; i < priv->divs_x + 1; i++) {
-		g_autofree gchar *text = NULL;
 		b = priv->box_x + ((gdouble) i * divwidth);
 		value = ((length_x / (gdouble)priv->divs_x) * (gdouble) i) + (gdouble) priv->start_x;
-		text = egg_graph_widget_get_axis_label (priv->type_x, value);
+		label = egg_graph_widget_get_label (graph, priv->type_x, value);
 
-		pango_layout_set_text (priv->layout, text, -1);
-		pango_layout_get_pixel_extents (priv->layout, &ink_rect, &logical_rect);
 		/* have data points 0 and 10 bounded, but 1..9 centered */
 		if (i == 0)
 			offsetx = 2.0;
 		else if (i == priv->divs_x)
-			offsetx = ink_rect.width;
+			offsetx = label->ink_rect.width;
 		else
-			offsetx = (ink_rect.width / 2.0f);
-
-		cairo_move_to (cr, b - offsetx,
-			       priv->box_y + priv->box_height + 2.0);
+			offsetx = (label->ink_rect.width / 2.0f);
 
-		pango_cairo_show_layout (cr, priv->layout);
+		egg_graph_widget_show_layout (label->layout, cr, snapshot, b - offsetx,
+					      priv->box_y + priv->box_height + 2.0,
+					      &text_color);
 	}
 
 	/* do y text */
 	for (i = 0; i < 11; i++) {
-		g_autofree gchar *text = NULL;
 		b = priv->box_y + ((gdouble) i * divheight);
 		value = ((gdouble) length_y / 10.0f) * (10 - (gdouble) i) + priv->start_y;
-		text = egg_graph_widget_get_axis_label (priv->type_y, value);
-
-		pango_layout_set_text (priv->layout, text, -1);
-		pango_layout_get_pixel_extents (priv->layout, &ink_rect, &logical_rect);
+		label = egg_graph_widget_get_label (graph, priv->type_y, value);
 
 		/* have data points 0 and 10 bounded, but 1..9 centered */
 		if (i == 10)
 			offsety = 0;
 		else if (i == 0)
-			offsety = ink_rect.height;
+			offsety = label->ink_rect.height;
 		else
-			offsety = (ink_rect.height / 2.0f);
-		offsetx = ink_rect.width + 7;
+			offsety = (label->ink_rect.height / 2.0f);
+		offsetx = label->ink_rect.width + 7;
 		offsety -= 10;
-		cairo_move_to (cr, priv->box_x - offsetx - 2, b + offsety);
-		pango_cairo_show_layout (cr, priv->layout);
+		egg_graph_widget_show_layout (label->layout, cr, snapshot,
+					      priv->box_x - offsetx - 2, b + offsety,
+					      &text_color);
 	}
 
-	cairo_restore (cr);
+	if (cr != NULL)
+		cairo_restore (cr);
 }
 
 static void
@@ -572,24 +1258,21 @@ egg_color_to_rgb (guint32 color, guint8 *red, guint8 *green, guint8 *blue)
 }
 
 static guint
-egg_graph_widget_get_y_label_max_width (EggGraphWidget *graph, cairo_t *cr)
+egg_graph_widget_get_y_label_max_width (EggGraphWidget *graph)
 {
 	EggGraphWidgetPrivate *priv = GET_PRIVATE (graph);
 	guint i;
-	gint value;
-	gint length_y = priv->stop_y - priv->start_y;
-	PangoRectangle ink_rect, logical_rect;
+	gdouble value;
+	gdouble length_y = priv->stop_y - priv->start_y;
+	EggGraphWidgetLabel *label;
 	guint biggest = 0;
 
-	/* do y text */
+	/* do y text, with the same values as draw_labels so the cache is shared */
 	for (i = 0; i < 11; i++) {
-		g_autofree gchar *text = NULL;
-		value = (length_y / 10) * (10 - (gdouble) i) + priv->start_y;
-		text = egg_graph_widget_get_axis_label (priv->type_y, value);
-		pango_layout_set_text (priv->layout, text, -1);
-		pango_layout_get_pixel_extents (priv->layout, &ink_rect, &logical_rect);
-		if (ink_rect.width > (gint) biggest)
-			biggest = ink_rect.width;
+		value = ((gdouble) length_y / 10.0f) * (10 - (gdouble) i) + priv->start_y;
+		label = egg_graph_widget_get_label (graph, priv->type_y, value);
+		if (label->ink_rect.width > (gint) biggest)
+			biggest = label->ink_rect.width;
 	}
 	return biggest;
 }
@@ -660,13 +1343,12 @@ static void
 egg_graph_widget_autorange_x (EggGraphWidget *graph)
 {
 	EggGraphWidgetPrivate *priv = GET_PRIVATE (graph);
-	EggGraphPoint *point;
 	GPtrArray *array;
-	GPtrArray *data;
+	EggGraphSeries *data;
 	gdouble biggest_x = G_MINFLOAT;
 	gdouble smallest_x = G_MAXFLOAT;
 	guint rounding_x = 1;
-	guint i, j;
+	guint j;
 	guint len = 0;
 
 	array = priv->data_list;
@@ -687,16 +1369,15 @@ egg_graph_widget_autorange_x (EggGraphWidget *graph)
 		return;
 	}
 
-	/* get the range for the graph */
+	/* get the range for the graph from the bounds of each series */
 	for (j = 0; j < array->len; j++) {
 		data = g_ptr_array_index (array, j);
-		for (i = 0; i < data->len; i++) {
-			point = (EggGraphPoint *) g_ptr_array_index (data, i);
-			if (point->x > biggest_x)
-				biggest_x = point->x;
-			if (point->x < smallest_x)
-				smallest_x = point->x;
-		}
+		if (data->len == 0)
+			continue;
+		if (data->max_x > biggest_x)
+			biggest_x = data->max_x;
+		if (data->min_x < smallest_x)
+			smallest_x = data->min_x;
 	}
 	g_debug ("Data range is %f<x<%f", smallest_x, biggest_x);
 	/* don't allow no difference */
@@ -758,9 +1439,8 @@ egg_graph_widget_autorange_y (EggGraphWidget *graph)
 	gdouble biggest_y = G_MINFLOAT;
 	gdouble smallest_y = G_MAXFLOAT;
 	guint rounding_y = 1;
-	GPtrArray *data;
-	EggGraphPoint *point;
-	guint i, j;
+	EggGraphSeries *data;
+	guint j;
 	guint len = 0;
 	GPtrArray *array;
 
@@ -782,16 +1462,15 @@ egg_graph_widget_autorange_y (EggGraphWidget *graph)
 		return;
 	}
 
-	/* get the range for the graph */
+	/* get the range for the graph from the bounds of each series */
 	for (j = 0; j < array->len; j++) {
 		data = g_ptr_array_index (array, j);
-		for (i=0; i < data->len; i++) {
-			point = (EggGraphPoint *) g_ptr_array_index (data, i);
-			if (point->y > biggest_y)
-				biggest_y = point->y;
-			if (point->y < smallest_y)
-				smallest_y = point->y;
-		}
+		if (data->len == 0)
+			continue;
+		if (data->max_y > biggest_y)
+			biggest_y = data->max_y;
+		if (data->min_y < smallest_y)
+			smallest_y = data->min_y;
 	}
 	g_debug ("Data range is %f<y<%f", smallest_y, biggest_y);
 	/* don't allow no difference */
@@ -855,6 +1534,45 @@ egg_graph_widget_set_color (cairo_t *cr, guint32 color)
 	cairo_set_source_rgb (cr, ((gdouble) r)/256.0f, ((gdouble) g)/256.0f, ((gdouble) b)/256.0f);
 }
 
+static void
+egg_graph_widget_get_rgba (guint32 color, GdkRGBA *rgba)
+{
+	guint8 r, g, b;
+	egg_color_to_rgb (color, &r, &g, &b);
+	rgba->red = ((gfloat) r) / 256.0f;
+	rgba->green = ((gfloat) g) / 256.0f;
+	rgba->blue = ((gfloat) b) / 256.0f;
+	rgba->alpha = 1.0f;
+}
+
+/**
+ * egg_graph_widget_snapshot_box:
+ * @snapshot: The snapshot to add the nodes to
+ * @bounds: The outside of the box
+ * @fill: (nullable): The color inside the box
+ * @border_width: The width of the outline, drawn inside @bounds
+ * @border: The color of the outline
+ *
+ * The render node equivalent of filling a rectangle then stroking its
+ * outline on the half pixel.
+ **/
+static void
+egg_graph_widget_snapshot_box (GtkSnapshot *snapshot,
+			       const graphene_rect_t *bounds,
+			       const GdkRGBA *fill,
+			       gfloat border_width,
+			       const GdkRGBA *border)
+{
+	GskRoundedRect outline;
+	const gfloat widths[4] = { border_width, border_width, border_width, border_width };
+	const GdkRGBA colors[4] = { *border, *border, *border, *border };
+
+	if (fill != NULL)
+		gtk_snapshot_append_color (snapshot, fill, bounds);
+	gsk_rounded_rect_init_from_rect (&outline, bounds, 0);
+	gtk_snapshot_append_border (snapshot, &outline, widths, colors);
+}
+
 /**
  * egg_graph_widget_draw_legend_line:
  * @cr: Cairo drawing context
@@ -898,6 +1616,107 @@ egg_graph_widget_get_pos_on_graph (EggGraphWidget *graph,
 	*y = priv->box_y + (priv->unit_y * (gdouble)(priv->stop_y - data_y)) + 1.5;
 }
 
+/* the points that might be in view, or all of them if that can't be told */
+static void
+egg_graph_widget_get_visible_range (EggGraphWidget *graph, EggGraphSeries *data,
+				    guint *first, guint *end)
+{
+	EggGraphWidgetPrivate *priv = GET_PRIVATE (graph);
+	if (!egg_graph_series_find_range (data, priv->start_x, priv->stop_x, first, end)) {
+		*first = 0;
+		*end = data->len;
+	}
+}
+
+/**
+ * egg_graph_widget_get_visible_line:
+ * @graph: This class instance
+ * @data: The series to draw
+ *
+ * Gets the part of the series that is in view, taken from the coarsest
+ * level of detail that still has a few points per pixel column and then
+ * decimated to the columns, so any zoom level draws in time bounded by
+ * the width of the widget.
+ *
+ * Return value: a series to draw, free with egg_graph_series_unref()
+ **/
+static EggGraphSeries *
+egg_graph_widget_get_visible_line (EggGraphWidget *graph, EggGraphSeries *data)
+{
+	EggGraphWidgetPrivate *priv = GET_PRIVATE (graph);
+	EggGraphSeries *lod;
+	guint points;
+	guint first, end;
+
+	points = (guint) MAX (priv->box_width, 1) * EGG_GRAPH_WIDGET_DECIMATE_POINTS_PER_COLUMN;
+	if (data->len <= points)
+		return egg_graph_series_ref (data);
+
+	lod = egg_graph_series_get_lod (data, priv->start_x, priv->stop_x, points);
+	egg_graph_widget_get_visible_range (graph, lod, &first, &end);
+	if (first == end)
+		return egg_graph_series_new ();
+
+	/* keep the point before, as the first point of a line is not drawn */
+	if (first > 0)
+		first--;
+	return egg_graph_series_decimate_range (lod, first, end,
+						priv->start_x,
+						priv->stop_x,
+						priv->unit_x);
+}
+
+/**
+ * egg_graph_widget_get_visible_dots:
+ * @graph: This class instance
+ * @data: The series to draw
+ *
+ * Gets the points of the series that are in view, taken from the same
+ * level of detail as the line, and keeping only the first point that
+ * lands on each pixel. The number of dots is then bounded by the size of
+ * the graph rather than by the length of the series.
+ *
+ * Return value: a series to draw, free with egg_graph_series_unref()
+ **/
+static EggGraphSeries *
+egg_graph_widget_get_visible_dots (EggGraphWidget *graph, EggGraphSeries *data)
+{
+	EggGraphWidgetPrivate *priv = GET_PRIVATE (graph);
+	EggGraphSeries *lod;
+	EggGraphSeries *dots;
+	g_autofree guint32 *occupied = NULL;
+	gdouble x, y;
+	gint px, py;
+	guint width, height;
+	guint points;
+	guint first, end;
+	guint bit;
+	guint i;
+
+	width = (guint) MAX (priv->box_width, 1);
+	height = (guint) MAX (priv->box_height, 1);
+	points = width * EGG_GRAPH_WIDGET_DECIMATE_POINTS_PER_COLUMN;
+	lod = egg_graph_series_get_lod (data, priv->start_x, priv->stop_x, points);
+	egg_graph_widget_get_visible_range (graph, lod, &first, &end);
+
+	/* one bit per pixel of the box */
+	occupied = g_new0 (guint32, (width * height + 31) / 32);
+	dots = egg_graph_series_sized_new (MIN (end - first, width * height));
+	for (i = first; i < end; i++) {
+		if (lod->x[i] < priv->start_x || lod->x[i] > priv->stop_x)
+			continue;
+		egg_graph_widget_get_pos_on_graph (graph, lod->x[i], lod->y[i], &x, &y);
+		px = CLAMP ((gint) x - priv->box_x, 0, (gint) width - 1);
+		py = CLAMP ((gint) y - priv->box_y, 0, (gint) height - 1);
+		bit = (guint) py * width + (guint) px;
+		if (occupied[bit / 32] & (1u << (bit % 32)))
+			continue;
+		occupied[bit / 32] |= 1u << (bit % 32);
+		egg_graph_series_append (dots, lod->x[i], lod->y[i], lod->color[i]);
+	}
+	return dots;
+}
+
 static void
 egg_graph_widget_draw_dot (cairo_t *cr, gdouble x, gdouble y, guint32 color)
 {
@@ -917,10 +1736,11 @@ static void
 egg_graph_widget_draw_line (EggGraphWidget *graph, cairo_t *cr)
 {
 	EggGraphWidgetPrivate *priv = GET_PRIVATE (graph);
-	GPtrArray *data;
+	EggGraphSeries *data;
+	g_autoptr(EggGraphSeries) line = NULL;
+	g_autoptr(EggGraphSeries) dots = NULL;
 	GPtrArray *array;
 	EggGraphWidgetPlot plot;
-	EggGraphPoint *point;
 	gdouble x, y;
 	guint i, j;
 
@@ -939,19 +1759,13 @@ egg_graph_widget_draw_line (EggGraphWidget *graph, cairo_t *cr)
 			continue;
 		plot = GPOINTER_TO_UINT (g_ptr_array_index (priv->plot_list, j));
 
-		/* get the very first point so we can work out the old */
-		point = (EggGraphPoint *) g_ptr_array_index (data, 0);
-		x = 0;
-		y = 0;
-		egg_graph_widget_get_pos_on_graph (graph, point->x, point->y, &x, &y);
-
-		/* plot points */
+		/* plot points, at most one per pixel */
 		if (plot == EGG_GRAPH_WIDGET_PLOT_POINTS || plot == EGG_GRAPH_WIDGET_PLOT_BOTH) {
-			egg_graph_widget_draw_dot (cr, x, y, point->color);
-			for (i = 1; i < data->len; i++) {
-				point = (EggGraphPoint *) g_ptr_array_index (data, i);
-				egg_graph_widget_get_pos_on_graph (graph, point->x, point->y, &x, &y);
-				egg_graph_widget_draw_dot (cr, x, y, point->color);
+			g_clear_pointer (&dots, egg_graph_series_unref);
+			dots = egg_graph_widget_get_visible_dots (graph, data);
+			for (i = 0; i < dots->len; i++) {
+				egg_graph_widget_get_pos_on_graph (graph, dots->x[i], dots->y[i], &x, &y);
+				egg_graph_widget_draw_dot (cr, x, y, dots->color[i]);
 			}
 		}
 
@@ -961,25 +1775,29 @@ egg_graph_widget_draw_line (EggGraphWidget *graph, cairo_t *cr)
 			guint32 old_color = 0xffffff;
 			cairo_set_line_width (cr, 1.5);
 
+			/* the line can't show more than a few points per column */
+			g_clear_pointer (&line, egg_graph_series_unref);
+			line = egg_graph_widget_get_visible_line (graph, data);
+			data = line;
+
 			for (i = 1; i < data->len; i++) {
-				point = (EggGraphPoint *) g_ptr_array_index (data, i);
 
 				/* ignore anything out of range */
-				if (point->x < priv->start_x ||
-				    point->x > priv->stop_x) {
+				if (data->x[i] < priv->start_x ||
+				    data->x[i] > priv->stop_x) {
 					continue;
 				}
 
 				/* ignore white lines */
-				if (point->color == 0xffffff)
+				if (data->color[i] == 0xffffff)
 					continue;
 
 				/* is graph color the same */
 				egg_graph_widget_get_pos_on_graph (graph,
-								  point->x,
-								  point->y,
+								  data->x[i],
+								  data->y[i],
 								  &x, &y);
-				if (point->color == old_color) {
+				if (data->color[i] == old_color) {
 					cairo_line_to (cr, x, y);
 					continue;
 				}
@@ -989,9 +1807,9 @@ egg_graph_widget_draw_line (EggGraphWidget *graph, cairo_t *cr)
 					cairo_stroke (cr);
 
 				/* start new color line */
-				old_color = point->color;
+				old_color = data->color[i];
 				cairo_move_to (cr, x, y);
-				egg_graph_widget_set_color (cr, point->color);
+				egg_graph_widget_set_color (cr, data->color[i]);
 			}
 
 			/* finish current line */
@@ -1033,25 +1851,43 @@ egg_graph_widget_draw_bounding_box (cairo_t *cr, gint x, gint y, gint width, gin
  * @height: The item height
  **/
 static void
-egg_graph_widget_draw_legend (EggGraphWidget *graph, cairo_t *cr,
+egg_graph_widget_draw_legend (EggGraphWidget *graph, cairo_t *cr, GtkSnapshot *snapshot,
 			      gint x, gint y, gint width, gint height)
 {
 	EggGraphWidgetPrivate *priv = GET_PRIVATE (graph);
 	gint y_count;
 	guint i;
 	EggGraphWidgetLegendData *legend_data;
-
-	egg_graph_widget_draw_bounding_box (cr, x, y, width, height);
+	const GdkRGBA white = { 1.f, 1.f, 1.f, 1.f };
+	const GdkRGBA black = { 0.f, 0.f, 0.f, 1.f };
+	const GdkRGBA outline = { 0.1f, 0.1f, 0.1f, 1.f };
+	GdkRGBA color;
+
+	if (snapshot != NULL) {
+		egg_graph_widget_snapshot_box (snapshot,
+					       &GRAPHENE_RECT_INIT (x, y, width, height),
+					       &white, 1.f, &outline);
+	} else {
+		egg_graph_widget_draw_bounding_box (cr, x, y, width, height);
+	}
 	y_count = y + 10;
 
 	/* add the line colors to the legend */
 	for (i = 0; i < priv->legend_list->len; i++) {
 		legend_data = g_ptr_array_index (priv->legend_list, i);
-		egg_graph_widget_draw_legend_line (cr, x + 8, y_count, legend_data->color);
-		cairo_move_to (cr, x + 8 + 10, y_count - 6);
-		cairo_set_source_rgb (cr, 0, 0, 0);
+		if (snapshot != NULL) {
+			/* the same pixels as the stroked 10x6 swatch */
+			egg_graph_widget_get_rgba (legend_data->color, &color);
+			egg_graph_widget_snapshot_box (snapshot,
+						       &GRAPHENE_RECT_INIT (x + 8 - 5, y_count - 3, 11, 7),
+						       &color, 1.f, &outline);
+		} else {
+			egg_graph_widget_draw_legend_line (cr, x + 8, y_count, legend_data->color);
+			cairo_set_source_rgb (cr, 0, 0, 0);
+		}
 		pango_layout_set_text (priv->layout, legend_data->desc, -1);
-		pango_cairo_show_layout (cr, priv->layout);
+		egg_graph_widget_show_layout (priv->layout, cr, snapshot,
+					      x + 8 + 10, y_count - 6, &black);
 		y_count = y_count + EGG_GRAPH_WIDGET_LEGEND_SPACING;
 	}
 }
@@ -1062,7 +1898,7 @@ egg_graph_widget_draw_legend (EggGraphWidget *graph, cairo_t *cr,
  * from machine to machine.
  **/
 static gboolean
-egg_graph_widget_legend_calculate_size (EggGraphWidget *graph, cairo_t *cr,
+egg_graph_widget_legend_calculate_size (EggGraphWidget *graph,
 					guint *width, guint *height)
 {
 	EggGraphWidgetPrivate *priv = GET_PRIVATE (graph);
@@ -1097,48 +1933,54 @@ egg_graph_widget_legend_calculate_size (EggGraphWidget *graph, cairo_t *cr,
 	return TRUE;
 }
 
-static gboolean
-egg_graph_widget_draw (GtkWidget *widget, cairo_t *cr)
+/**
+ * egg_graph_widget_layout:
+ * @graph: This class instance
+ * @width: The widget width
+ * @height: The widget height
+ *
+ * Works out where the box and legend go, and the scale of the data.
+ **/
+static void
+egg_graph_widget_layout (EggGraphWidget *graph, gint width, gint height)
 {
-	GtkAllocation allocation;
-	gint legend_x = 0;
-	gint legend_y = 0;
-	guint legend_height = 0;
-	guint legend_width = 0;
+	EggGraphWidgetPrivate *priv = GET_PRIVATE (graph);
 	gdouble data_x;
 	gdouble data_y;
 
-	EggGraphWidget *graph = (EggGraphWidget*) widget;
-	EggGraphWidgetPrivate *priv = GET_PRIVATE (graph);
-	g_return_val_if_fail (graph != NULL, FALSE);
-	g_return_val_if_fail (EGG_IS_GRAPH_WIDGET (graph), FALSE);
-
-	egg_graph_widget_legend_calculate_size (graph, cr, &legend_width, &legend_height);
-	cairo_save (cr);
+	egg_graph_widget_legend_calculate_size (graph, &priv->legend_width, &priv->legend_height);
 
 	/* we need this so we know the y text */
-	if (priv->autorange_x)
-		egg_graph_widget_autorange_x (graph);
-	if (priv->autorange_y)
-		egg_graph_widget_autorange_y (graph);
-
-	priv->box_x = egg_graph_widget_get_y_label_max_width (graph, cr) + 10;
+	priv->box_x = egg_graph_widget_get_y_label_max_width (graph) + 10;
 	priv->box_y = 5;
-
-	gtk_widget_get_allocation (widget, &allocation);
-	priv->box_height = allocation.height - (20 + priv->box_y);
+	priv->box_height = height - (20 + priv->box_y);
 
 	/* make size adjustment for legend */
-	if (priv->use_legend && legend_height > 0) {
-		priv->box_width = allocation.width -
-					 (3 + legend_width + 5 + priv->box_x);
-		legend_x = priv->box_x + priv->box_width + 6;
-		legend_y = priv->box_y;
+	if (priv->use_legend && priv->legend_height > 0) {
+		priv->box_width = width -
+					 (3 + priv->legend_width + 5 + priv->box_x);
+		priv->legend_x = priv->box_x + priv->box_width + 6;
+		priv->legend_y = priv->box_y;
 	} else {
-		priv->box_width = allocation.width -
+		priv->box_width = width -
 					 (3 + priv->box_x);
 	}
 
+	/* -3 is so we can keep the lines inside the box at both extremes */
+	data_x = priv->stop_x - priv->start_x;
+	data_y = priv->stop_y - priv->start_y;
+	priv->unit_x = (gdouble)(priv->box_width - 3) / (gdouble) data_x;
+	priv->unit_y = (gdouble)(priv->box_height - 3) / (gdouble) data_y;
+}
+
+/* everything apart from the data itself */
+static void
+egg_graph_widget_draw_static (EggGraphWidget *graph, cairo_t *cr)
+{
+	EggGraphWidgetPrivate *priv = GET_PRIVATE (graph);
+
+	cairo_save (cr);
+
 	/* graph background */
 	egg_graph_widget_draw_bounding_box (cr, priv->box_x, priv->box_y,
 				     priv->box_width, priv->box_height);
@@ -1152,36 +1994,302 @@ egg_graph_widget_draw (GtkWidget *widget, cairo_t *cr)
 	cairo_set_line_width (cr, 1);
 	cairo_stroke (cr);
 
-	/* -3 is so we can keep the lines inside the box at both extremes */
-	data_x = priv->stop_x - priv->start_x;
-	data_y = priv->stop_y - priv->start_y;
-	priv->unit_x = (gdouble)(priv->box_width - 3) / (gdouble) data_x;
-	priv->unit_y = (gdouble)(priv->box_height - 3) / (gdouble) data_y;
+	egg_graph_widget_draw_labels (graph, cr, NULL);
+
+	if (priv->use_legend && priv->legend_height > 0)
+		egg_graph_widget_draw_legend (graph, cr, NULL,
+					      priv->legend_x, priv->legend_y,
+					      priv->legend_width, priv->legend_height);
+
+	cairo_restore (cr);
+}
+
+/* the same as egg_graph_widget_draw_static(), but as render nodes */
+static void
+egg_graph_widget_snapshot_static (EggGraphWidget *graph, GtkSnapshot *snapshot)
+{
+	EggGraphWidgetPrivate *priv = GET_PRIVATE (graph);
+	const GdkRGBA white = { 1.f, 1.f, 1.f, 1.f };
+	const GdkRGBA outline = { 0.6f, 0.6f, 0.6f, 1.f };
+	graphene_rect_t box;
+
+	/* graph background, the outline goes on top of the grid */
+	box = GRAPHENE_RECT_INIT (priv->box_x, priv->box_y, priv->box_width, priv->box_height);
+	gtk_snapshot_append_color (snapshot, &white, &box);
+	if (priv->use_grid) {
+#if GTK_CHECK_VERSION(4,14,0)
+		egg_graph_widget_snapshot_grid (graph, snapshot);
+#else
+		cairo_t *cr = gtk_snapshot_append_cairo (snapshot, &box);
+		egg_graph_widget_draw_grid (graph, cr);
+		cairo_destroy (cr);
+#endif
+	}
+	egg_graph_widget_snapshot_box (snapshot, &box, NULL, 1.f, &outline);
+
+	egg_graph_widget_draw_labels (graph, NULL, snapshot);
+
+	if (priv->use_legend && priv->legend_height > 0)
+		egg_graph_widget_draw_legend (graph, NULL, snapshot,
+					      priv->legend_x, priv->legend_y,
+					      priv->legend_width, priv->legend_height);
+}
+
+static void
+egg_graph_widget_snapshot_dot (GtkSnapshot *snapshot, gdouble x, gdouble y, guint32 color)
+{
+	const GdkRGBA black = { 0.f, 0.f, 0.f, 1.f };
+	GdkRGBA rgba;
+	gfloat width = 4.0f;
+
+	/* the 0.5px outline is centered on the edge of the box */
+	egg_graph_widget_get_rgba (color, &rgba);
+	egg_graph_widget_snapshot_box (snapshot,
+				       &GRAPHENE_RECT_INIT ((gint)x + 0.25f - (width/2),
+							    (gint)y + 0.25f - (width/2),
+							    width + 0.5f, width + 0.5f),
+				       &rgba, 0.5f, &black);
+}
+
+#if GTK_CHECK_VERSION(4,14,0)
+static void
+egg_graph_widget_snapshot_stroke (GtkSnapshot *snapshot, GskPathBuilder *builder, guint32 color)
+{
+	GskPath *path;
+	GskStroke *stroke;
+	GdkRGBA rgba;
+
+	path = gsk_path_builder_free_to_path (builder);
+	stroke = gsk_stroke_new (1.5f);
+	egg_graph_widget_get_rgba (color, &rgba);
+	gtk_snapshot_append_stroke (snapshot, path, stroke, &rgba);
+	gsk_stroke_free (stroke);
+	gsk_path_unref (path);
+}
+
+/* fills and outlines a run of same colored dots as one node each, rather
+ * than a pair of nodes for every dot */
+static void
+egg_graph_widget_snapshot_dots (GtkSnapshot *snapshot, GskPathBuilder *builder, guint32 color)
+{
+	const GdkRGBA black = { 0.f, 0.f, 0.f, 1.f };
+	GskPath *path;
+	GskStroke *stroke;
+	GdkRGBA rgba;
+
+	path = gsk_path_builder_free_to_path (builder);
+	egg_graph_widget_get_rgba (color, &rgba);
+	gtk_snapshot_append_fill (snapshot, path, GSK_FILL_RULE_WINDING, &rgba);
+	stroke = gsk_stroke_new (0.5f);
+	gtk_snapshot_append_stroke (snapshot, path, stroke, &black);
+	gsk_stroke_free (stroke);
+	gsk_path_unref (path);
+}
+
+/* the same as egg_graph_widget_draw_line(), but as render nodes */
+static void
+egg_graph_widget_snapshot_line (EggGraphWidget *graph, GtkSnapshot *snapshot)
+{
+	EggGraphWidgetPrivate *priv = GET_PRIVATE (graph);
+	EggGraphSeries *data;
+	g_autoptr(EggGraphSeries) line = NULL;
+	g_autoptr(EggGraphSeries) dots = NULL;
+	GskPathBuilder *builder;
+	EggGraphWidgetPlot plot;
+	const gfloat dot_width = 4.0f;
+	gdouble x, y;
+	guint32 old_color;
+	guint i, j;
+
+	for (j = 0; j < priv->data_list->len; j++) {
+		data = g_ptr_array_index (priv->data_list, j);
+		if (data->len == 0)
+			continue;
+		plot = GPOINTER_TO_UINT (g_ptr_array_index (priv->plot_list, j));
+
+		/* plot points, at most one per pixel */
+		if (plot == EGG_GRAPH_WIDGET_PLOT_POINTS || plot == EGG_GRAPH_WIDGET_PLOT_BOTH) {
+			g_clear_pointer (&dots, egg_graph_series_unref);
+			dots = egg_graph_widget_get_visible_dots (graph, data);
+			builder = NULL;
+			old_color = 0;
+			for (i = 0; i < dots->len; i++) {
+				if (builder != NULL && dots->color[i] != old_color) {
+					egg_graph_widget_snapshot_dots (snapshot, builder, old_color);
+					builder = NULL;
+				}
+				if (builder == NULL) {
+					builder = gsk_path_builder_new ();
+					old_color = dots->color[i];
+				}
+				egg_graph_widget_get_pos_on_graph (graph, dots->x[i], dots->y[i], &x, &y);
+				gsk_path_builder_add_rect (builder,
+							   &GRAPHENE_RECT_INIT ((gint) x + 0.5f - (dot_width / 2),
+										(gint) y + 0.5f - (dot_width / 2),
+										dot_width, dot_width));
+			}
+			if (builder != NULL)
+				egg_graph_widget_snapshot_dots (snapshot, builder, old_color);
+		}
+
+		if (plot != EGG_GRAPH_WIDGET_PLOT_LINE && plot != EGG_GRAPH_WIDGET_PLOT_BOTH)
+			continue;
+
+		/* the line can't show more than a few points per column */
+		g_clear_pointer (&line, egg_graph_series_unref);
+		line = egg_graph_widget_get_visible_line (graph, data);
+		data = line;
+
+		/* one path per run of the same color */
+		builder = NULL;
+		old_color = 0xffffff;
+		for (i = 1; i < data->len; i++) {
+			if (data->x[i] < priv->start_x || data->x[i] > priv->stop_x)
+				continue;
+			if (data->color[i] == 0xffffff)
+				continue;
+			egg_graph_widget_get_pos_on_graph (graph, data->x[i], data->y[i], &x, &y);
+			if (builder != NULL && data->color[i] == old_color) {
+				gsk_path_builder_line_to (builder, x, y);
+				continue;
+			}
+			if (builder != NULL)
+				egg_graph_widget_snapshot_stroke (snapshot, builder, old_color);
+			old_color = data->color[i];
+			builder = gsk_path_builder_new ();
+			gsk_path_builder_move_to (builder, x, y);
+		}
+		if (builder != NULL)
+			egg_graph_widget_snapshot_stroke (snapshot, builder, old_color);
+	}
+}
+#endif
+
+static void
+egg_graph_widget_autorange (EggGraphWidget *graph)
+{
+	EggGraphWidgetPrivate *priv = GET_PRIVATE (graph);
+
+	/* the zoom is inside the range the data had when it started */
+	if (priv->autorange_x && !priv->zoomed)
+		egg_graph_widget_autorange_x (graph);
+	if (priv->autorange_y)
+		egg_graph_widget_autorange_y (graph);
+}
+
+/* draws at any size, so the widget does not have to be shown or even
+ * have a display */
+static void
+egg_graph_widget_draw (EggGraphWidget *graph, cairo_t *cr, gint width, gint height)
+{
+	egg_graph_widget_autorange (graph);
+	egg_graph_widget_layout (graph, width, height);
 
-	egg_graph_widget_draw_labels (graph, cr);
+	egg_graph_widget_draw_static (graph, cr);
 	egg_graph_widget_draw_line (graph, cr);
 
-	if (priv->use_legend && legend_height > 0)
-		egg_graph_widget_draw_legend (graph, cr, legend_x, legend_y, legend_width, legend_height);
+	/* the layout no longer matches what is on screen */
+	egg_graph_widget_invalidate_static (graph);
+}
 
-	cairo_restore (cr);
-	return FALSE;
+/* the static layer only depends on the size, ranges and properties */
+static gboolean
+egg_graph_widget_static_is_valid (EggGraphWidget *graph, gint width, gint height)
+{
+	EggGraphWidgetPrivate *priv = GET_PRIVATE (graph);
+	return priv->static_node != NULL &&
+	       priv->static_width == width &&
+	       priv->static_height == height &&
+	       priv->static_start_x == priv->start_x &&
+	       priv->static_stop_x == priv->stop_x &&
+	       priv->static_start_y == priv->start_y &&
+	       priv->static_stop_y == priv->stop_y;
+}
+
+static void
+egg_graph_widget_snapshot_crosshair (EggGraphWidget *graph, GtkSnapshot *snapshot)
+{
+	EggGraphWidgetPrivate *priv = GET_PRIVATE (graph);
+	const GdkRGBA hair = { 0.3f, 0.3f, 0.3f, 0.6f };
+	EggGraphSeries *data;
+	guint i = priv->hover_idx;
+	gdouble x, y;
+
+	/* the sample may have been zoomed out of view */
+	data = g_ptr_array_index (priv->data_list, priv->hover_series);
+	if (data->x[i] < priv->start_x || data->x[i] > priv->stop_x)
+		return;
+	egg_graph_widget_get_pos_on_graph (graph, data->x[i], data->y[i], &x, &y);
+	gtk_snapshot_append_color (snapshot, &hair,
+				   &GRAPHENE_RECT_INIT ((gint) x, priv->box_y + 1,
+							1, priv->box_height - 1));
+	if (y >= priv->box_y && y <= priv->box_y + priv->box_height) {
+		gtk_snapshot_append_color (snapshot, &hair,
+					   &GRAPHENE_RECT_INIT (priv->box_x + 1, (gint) y,
+								priv->box_width - 1, 1));
+		egg_graph_widget_snapshot_dot (snapshot, x, y, data->color[i]);
+	}
 }
 
 static void
 egg_graph_widget_snapshot (GtkWidget* widget, GtkSnapshot* snapshot)
 {
+	EggGraphWidget *graph = (EggGraphWidget*) widget;
+	EggGraphWidgetPrivate *priv = GET_PRIVATE (graph);
 	GtkAllocation allocation;
-	graphene_rect_t rect;
-	cairo_t *ctx;
 
 	gtk_widget_get_allocation (widget, &allocation);
-	rect = GRAPHENE_RECT_INIT (0, 0, allocation.width, allocation.height);
-	ctx = gtk_snapshot_append_cairo (snapshot, &rect);
 
-	egg_graph_widget_draw (GTK_WIDGET (widget), ctx);
+	/* the ranges may follow the data */
+	egg_graph_widget_autorange (graph);
+
+	/* only redraw the box, grid and labels when something moved */
+	if (!egg_graph_widget_static_is_valid (graph, allocation.width, allocation.height)) {
+		GtkSnapshot *layer = gtk_snapshot_new ();
+		egg_graph_widget_invalidate_static (graph);
+		egg_graph_widget_layout (graph, allocation.width, allocation.height);
+		egg_graph_widget_snapshot_static (graph, layer);
+		priv->static_node = gtk_snapshot_free_to_node (layer);
+		priv->static_width = allocation.width;
+		priv->static_height = allocation.height;
+		priv->static_start_x = priv->start_x;
+		priv->static_stop_x = priv->stop_x;
+		priv->static_start_y = priv->start_y;
+		priv->static_stop_y = priv->stop_y;
+	}
+	if (priv->static_node != NULL)
+		gtk_snapshot_append_node (snapshot, priv->static_node);
+
+	/* the data, kept so moving the pointer only redraws the crosshair;
+	 * stroking paths needs GTK 4.14 */
+	if (priv->data_node == NULL) {
+		GtkSnapshot *layer = gtk_snapshot_new ();
+#if GTK_CHECK_VERSION(4,14,0)
+		egg_graph_widget_snapshot_line (graph, layer);
+#else
+		graphene_rect_t rect = GRAPHENE_RECT_INIT (0, 0, allocation.width, allocation.height);
+		cairo_t *ctx = gtk_snapshot_append_cairo (layer, &rect);
+		egg_graph_widget_draw_line (graph, ctx);
+		cairo_destroy (ctx);
+#endif
+		priv->data_node = gtk_snapshot_free_to_node (layer);
+	}
+	if (priv->data_node != NULL)
+		gtk_snapshot_append_node (snapshot, priv->data_node);
+
+	/* the range being dragged out to zoom into */
+	if (priv->selecting && priv->select_stop != priv->select_start) {
+		const GdkRGBA band = { 0.2f, 0.4f, 0.8f, 0.25f };
+		graphene_rect_t rect;
+		rect = GRAPHENE_RECT_INIT (MIN (priv->select_start, priv->select_stop),
+					   priv->box_y,
+					   fabs (priv->select_stop - priv->select_start),
+					   priv->box_height);
+		gtk_snapshot_append_color (snapshot, &band, &rect);
+	}
 
-	cairo_destroy (ctx);
+	if (priv->hover_valid)
+		egg_graph_widget_snapshot_crosshair (graph, snapshot);
 }
 
 static cairo_status_t
@@ -1190,12 +2298,27 @@ egg_graph_widget_export_to_svg_cb (void *user_data,
 				   unsigned int length)
 {
 	GString *str = (GString *) user_data;
-	g_autofree gchar *tmp = NULL;
-	tmp = g_strndup ((const gchar *) data, length);
-	g_string_append (str, tmp);
+	g_string_append_len (str, (const gchar *) data, length);
 	return CAIRO_STATUS_SUCCESS;
 }
 
+/* roughly how big the SVG will be, so the string is only grown rarely */
+static gsize
+egg_graph_widget_export_to_svg_guess_size (EggGraphWidget *graph, guint width)
+{
+	EggGraphWidgetPrivate *priv = GET_PRIVATE (graph);
+	EggGraphSeries *data;
+	gsize points = 0;
+	guint i;
+
+	/* lines are decimated to a few points per column */
+	for (i = 0; i < priv->data_list->len; i++) {
+		data = g_ptr_array_index (priv->data_list, i);
+		points += MIN (data->len, width * EGG_GRAPH_WIDGET_DECIMATE_POINTS_PER_COLUMN);
+	}
+	return EGG_GRAPH_WIDGET_SVG_BASE_SIZE + points * EGG_GRAPH_WIDGET_SVG_POINT_SIZE;
+}
+
 gchar *
 egg_graph_widget_export_to_svg (EggGraphWidget *graph,
 				guint width,
@@ -1208,16 +2331,132 @@ egg_graph_widget_export_to_svg (EggGraphWidget *graph,
 	g_return_val_if_fail (EGG_IS_GRAPH_WIDGET (graph), NULL);
 
 	/* write the SVG data to a string */
-	str = g_string_new ("");
+	str = g_string_sized_new (egg_graph_widget_export_to_svg_guess_size (graph, width));
 	surface = cairo_svg_surface_create_for_stream (egg_graph_widget_export_to_svg_cb,
 						       str, width, height);
 	ctx = cairo_create (surface);
-	egg_graph_widget_draw (GTK_WIDGET (graph), ctx);
+	egg_graph_widget_draw (graph, ctx, width, height);
 	cairo_surface_destroy (surface);
 	cairo_destroy (ctx);
 	return g_string_free (str, FALSE);
 }
 
+typedef struct {
+	GOutputStream	*stream;
+	GCancellable	*cancellable;
+	GError		*error;
+} EggGraphWidgetExportHelper;
+
+static cairo_status_t
+egg_graph_widget_export_to_stream_cb (void *user_data,
+				      const unsigned char *data,
+				      unsigned int length)
+{
+	EggGraphWidgetExportHelper *helper = (EggGraphWidgetExportHelper *) user_data;
+
+	/* cairo keeps going after the first failure */
+	if (helper->error != NULL)
+		return CAIRO_STATUS_WRITE_ERROR;
+	if (!g_output_stream_write_all (helper->stream, data, length, NULL,
+					helper->cancellable, &helper->error))
+		return CAIRO_STATUS_WRITE_ERROR;
+	return CAIRO_STATUS_SUCCESS;
+}
+
+/**
+ * egg_graph_widget_export_to_svg_stream:
+ * @graph: This class instance
+ * @stream: a #GOutputStream
+ * @width: the width of the image
+ * @height: the height of the image
+ * @cancellable: a #GCancellable, or %NULL
+ * @error: a #GError, or %NULL
+ *
+ * Writes the graph as SVG to @stream as it is drawn, so the document is
+ * never held in memory. The stream is not closed.
+ *
+ * Return value: %TRUE for success
+ **/
+gboolean
+egg_graph_widget_export_to_svg_stream (EggGraphWidget *graph,
+				       GOutputStream *stream,
+				       guint width,
+				       guint height,
+				       GCancellable *cancellable,
+				       GError **error)
+{
+	EggGraphWidgetExportHelper helper = { stream, cancellable, NULL };
+	cairo_surface_t *surface;
+	cairo_status_t status;
+	cairo_t *ctx;
+
+	g_return_val_if_fail (EGG_IS_GRAPH_WIDGET (graph), FALSE);
+	g_return_val_if_fail (G_IS_OUTPUT_STREAM (stream), FALSE);
+
+	surface = cairo_svg_surface_create_for_stream (egg_graph_widget_export_to_stream_cb,
+						       &helper, width, height);
+	ctx = cairo_create (surface);
+	egg_graph_widget_draw (graph, ctx, width, height);
+	cairo_destroy (ctx);
+
+	/* the end of the document is only written when finishing */
+	cairo_surface_finish (surface);
+	status = cairo_surface_status (surface);
+	cairo_surface_destroy (surface);
+	if (helper.error != NULL) {
+		g_propagate_error (error, helper.error);
+		return FALSE;
+	}
+	if (status != CAIRO_STATUS_SUCCESS) {
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+			     "failed to export: %s", cairo_status_to_string (status));
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * egg_graph_widget_export_to_png:
+ * @graph: This class instance
+ * @filename: the file to write
+ * @width: the width of the image
+ * @height: the height of the image
+ * @error: a #GError, or %NULL
+ *
+ * Draws the graph into a PNG file. Like egg_graph_widget_export_to_svg()
+ * this works without the widget being shown.
+ *
+ * Return value: %TRUE for success
+ **/
+gboolean
+egg_graph_widget_export_to_png (EggGraphWidget *graph,
+				const gchar *filename,
+				guint width,
+				guint height,
+				GError **error)
+{
+	cairo_surface_t *surface;
+	cairo_status_t status;
+	cairo_t *ctx;
+
+	g_return_val_if_fail (EGG_IS_GRAPH_WIDGET (graph), FALSE);
+	g_return_val_if_fail (filename != NULL, FALSE);
+
+	surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, width, height);
+	ctx = cairo_create (surface);
+	egg_graph_widget_draw (graph, ctx, width, height);
+	cairo_destroy (ctx);
+	status = cairo_surface_write_to_png (surface, filename);
+	cairo_surface_destroy (surface);
+	if (status != CAIRO_STATUS_SUCCESS) {
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+			     "failed to write %s: %s",
+			     filename, cairo_status_to_string (status));
+		return FALSE;
+	}
+	return TRUE;
+}
+
 GtkWidget *
 egg_graph_widget_new (void)
 {
@@ -25,6 +25,7 @@
 #include <gtk/gtk.h>
 
 #include "egg-graph-point.h"
+#include "egg-graph-series.h"
 
 G_BEGIN_DECLS
 
@@ -61,13 +62,35 @@ void		 egg_graph_widget_set_use_legend	(EggGraphWidget		*graph,
 							 gboolean		 use_legend);
 gboolean	 egg_graph_widget_get_use_legend	(EggGraphWidget		*graph);
 
+gboolean	 egg_graph_widget_get_zoomed		(EggGraphWidget		*graph);
+void		 egg_graph_widget_zoom_reset		(EggGraphWidget		*graph);
+void		 egg_graph_widget_zoom_shift		(EggGraphWidget		*graph,
+							 gdouble		 offset);
+
 gchar		*egg_graph_widget_export_to_svg		(EggGraphWidget		*graph,
 							 guint			 width,
 							 guint			 height);
+gboolean	 egg_graph_widget_export_to_svg_stream	(EggGraphWidget		*graph,
+							 GOutputStream		*stream,
+							 guint			 width,
+							 guint			 height,
+							 GCancellable		*cancellable,
+							 GError			**error);
+gboolean	 egg_graph_widget_export_to_png		(EggGraphWidget		*graph,
+							 const gchar		*filename,
+							 guint			 width,
+							 guint			 height,
+							 GError			**error);
 void		 egg_graph_widget_data_clear		(EggGraphWidget		*graph);
 void		 egg_graph_widget_data_add		(EggGraphWidget		*graph,
 							 EggGraphWidgetPlot	 plot,
 							 GPtrArray		*array);
+void		 egg_graph_widget_data_add_series	(EggGraphWidget		*graph,
+							 EggGraphWidgetPlot	 plot,
+							 EggGraphSeries		*series);
+void		 egg_graph_widget_data_take		(EggGraphWidget		*graph,
+							 EggGraphWidgetPlot	 plot,
+							 EggGraphSeries		*series);
 void		 egg_graph_widget_key_legend_clear	(EggGraphWidget		*graph);
 void		 egg_graph_widget_key_legend_add	(EggGraphWidget		*graph,
 							 guint32		 color,
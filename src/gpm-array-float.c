@@ -31,6 +31,12 @@
 
 #include "gpm-array-float.h"
 
+struct _GpmArrayFloatIndex
+{
+	GpmArrayFloat	*array;
+	GArray		*sums;		/* of gdouble, or NULL when out of date */
+};
+
 /**
  * gpm_array_float_guassian_value:
  *
@@ -74,24 +80,163 @@ gpm_array_float_get (GpmArrayFloat *array, guint i)
 	return g_array_index (array, gfloat, i);
 }
 
+/**
+ * gpm_array_float_set:
+ * @array: This class instance
+ * @i: the index
+ * @value: the new value
+ *
+ * Sets one value in the array. Any #GpmArrayFloatIndex made from the array
+ * only notices a change of length, so call
+ * gpm_array_float_index_invalidate() after changing values in place.
+ **/
 void
 gpm_array_float_set (GpmArrayFloat *array, guint i, gfloat value)
 {
 	g_array_index (array, gfloat, i) = value;
 }
 
+/**
+ * gpm_array_float_index_new:
+ *
+ * @array: input array
+ * Return value: A new index, free with gpm_array_float_index_free()
+ *
+ * Keeps a cumulative sum of the array, so that
+ * gpm_array_float_index_compute_integral() and
+ * gpm_array_float_index_get_range_average() take constant time.
+ * The sums are built on the first query. If the array is changed after
+ * that, call gpm_array_float_index_invalidate() to have them rebuilt.
+ **/
+GpmArrayFloatIndex *
+gpm_array_float_index_new (GpmArrayFloat *array)
+{
+	GpmArrayFloatIndex *idx;
+
+	g_return_val_if_fail (array != NULL, NULL);
+
+	idx = g_new0 (GpmArrayFloatIndex, 1);
+	idx->array = g_array_ref (array);
+	return idx;
+}
+
+/**
+ * gpm_array_float_index_free:
+ *
+ * @idx: the index
+ *
+ * Frees the sums and drops the reference held on the array
+ **/
+void
+gpm_array_float_index_free (GpmArrayFloatIndex *idx)
+{
+	if (idx == NULL)
+		return;
+	if (idx->sums != NULL)
+		g_array_unref (idx->sums);
+	g_array_unref (idx->array);
+	g_free (idx);
+}
+
+/**
+ * gpm_array_float_index_invalidate:
+ *
+ * @idx: the index
+ *
+ * Marks the sums as out of date after the array has been changed
+ **/
+void
+gpm_array_float_index_invalidate (GpmArrayFloatIndex *idx)
+{
+	g_return_if_fail (idx != NULL);
+	g_clear_pointer (&idx->sums, g_array_unref);
+}
+
+/* returns len+1 sums where sums[i] is the total of the first i values */
+static const gdouble *
+gpm_array_float_index_get_sums (GpmArrayFloatIndex *idx)
+{
+	GpmArrayFloat *array = idx->array;
+	gdouble total = 0.0;
+	guint i;
+
+	/* the array has changed length, so it cannot be the same data */
+	if (idx->sums != NULL && idx->sums->len != array->len + 1)
+		gpm_array_float_index_invalidate (idx);
+	if (idx->sums != NULL)
+		return (const gdouble *) idx->sums->data;
+
+	/* build the index */
+	idx->sums = g_array_sized_new (FALSE, FALSE, sizeof (gdouble), array->len + 1);
+	g_array_append_val (idx->sums, total);
+	for (i = 0; i < array->len; i++) {
+		total += g_array_index (array, gfloat, i);
+		g_array_append_val (idx->sums, total);
+	}
+	return (const gdouble *) idx->sums->data;
+}
+
+/**
+ * gpm_array_float_index_compute_integral:
+ *
+ * @idx: the index
+ * @x1: the first index
+ * @x2: the last index, inclusive
+ *
+ * Like gpm_array_float_compute_integral(), but in constant time.
+ **/
+gfloat
+gpm_array_float_index_compute_integral (GpmArrayFloatIndex *idx, guint x1, guint x2)
+{
+	const gdouble *sums;
+
+	g_return_val_if_fail (idx != NULL, 0.0);
+	g_return_val_if_fail (x2 >= x1, 0.0);
+	g_return_val_if_fail (x2 < idx->array->len, 0.0);
+
+	/* if the same point, then we have no area */
+	if (x1 == x2)
+		return 0.0;
+
+	sums = gpm_array_float_index_get_sums (idx);
+	return sums[x2 + 1] - sums[x1];
+}
+
+/**
+ * gpm_array_float_index_get_range_average:
+ *
+ * @idx: the index
+ * @x1: the first index
+ * @x2: the last index, inclusive
+ *
+ * Like gpm_array_float_get_range_average(), but in constant time.
+ **/
+gfloat
+gpm_array_float_index_get_range_average (GpmArrayFloatIndex *idx, guint x1, guint x2)
+{
+	const gdouble *sums;
+
+	g_return_val_if_fail (idx != NULL, 0.0);
+	g_return_val_if_fail (x2 >= x1, 0.0);
+	g_return_val_if_fail (x2 < idx->array->len, 0.0);
+
+	sums = gpm_array_float_index_get_sums (idx);
+	return (sums[x2 + 1] - sums[x1]) / (x2 - x1 + 1);
+}
+
 /**
  * gpm_array_float_free:
  *
  * @array: input array
  *
- * Frees the array, deallocating data
+ * Drops a reference to the array, deallocating data if it was the last one
  **/
 void
 gpm_array_float_free (GpmArrayFloat *array)
 {
-	if (array != NULL)
-		g_array_free (array, TRUE);
+	if (array == NULL)
+		return;
+	g_array_unref (array);
 }
 
 /**
@@ -160,6 +305,63 @@ gpm_array_float_compute_gaussian (guint length, gfloat sigma)
 	return array;
 }
 
+/* normalized kernels shared by everyone, keyed by length and sigma */
+G_LOCK_DEFINE_STATIC (gaussian_cache);
+static GHashTable *gaussian_cache = NULL;
+
+/**
+ * gpm_array_float_get_gaussian:
+ *
+ * @length: length of output array
+ * @sigma: sigma value
+ * Return value: Gaussian array, or %NULL if sigma is too high for the size
+ *
+ * Gets a Gaussian array of a specified size, normalized so it sums to one.
+ * The array is computed once and shared, so it must not be modified.
+ * Free with gpm_array_float_free();
+ **/
+GpmArrayFloat *
+gpm_array_float_get_gaussian (guint length, gfloat sigma)
+{
+	GpmArrayFloat *array;
+	gint64 *key;
+	gint64 hash;
+	gfloat total;
+	guint32 sigma_bits;
+	guint i;
+
+	/* the float bits of sigma are stable, as it is always a constant */
+	memcpy (&sigma_bits, &sigma, sizeof (sigma_bits));
+	hash = ((gint64) length << 32) | sigma_bits;
+
+	G_LOCK (gaussian_cache);
+	if (gaussian_cache == NULL) {
+		gaussian_cache = g_hash_table_new_full (g_int64_hash, g_int64_equal,
+							g_free, (GDestroyNotify) g_array_unref);
+	}
+	array = g_hash_table_lookup (gaussian_cache, &hash);
+	if (array != NULL)
+		goto out;
+
+	array = gpm_array_float_compute_gaussian (length, sigma);
+	if (array == NULL)
+		goto out;
+
+	/* normalize so that smoothing does not change the scale */
+	total = gpm_array_float_sum (array);
+	for (i = 0; i < length; i++)
+		g_array_index (array, gfloat, i) /= total;
+
+	key = g_new (gint64, 1);
+	*key = hash;
+	g_hash_table_insert (gaussian_cache, key, array);
+out:
+	if (array != NULL)
+		g_array_ref (array);
+	G_UNLOCK (gaussian_cache);
+	return array;
+}
+
 /**
  * gpm_array_float_sum:
  *
@@ -200,22 +402,222 @@ gpm_array_float_print (GpmArrayFloat *array)
 	return TRUE;
 }
 
+/* the SIMD engines need the GCC/clang target attributes and cpu builtins */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GPM_ARRAY_FLOAT_HAVE_X86
+#include <immintrin.h>
+#endif
+#if defined(__GNUC__) && defined(__aarch64__)
+#define GPM_ARRAY_FLOAT_HAVE_NEON
+#include <arm_neon.h>
+#endif
+
+/* computes result[i] for start <= i < end, where all taps are inside data */
+typedef void (*GpmArrayFloatConvolveFunc)	(const gfloat	*data,
+						 const gfloat	*kernel,
+						 guint		 length_kernel,
+						 guint		 half_length,
+						 gfloat		*result,
+						 guint		 start,
+						 guint		 end);
+
+static void
+gpm_array_float_convolve_body_scalar (const gfloat *data, const gfloat *kernel,
+				      guint length_kernel, guint half_length,
+				      gfloat *result, guint start, guint end)
+{
+	const gfloat *src;
+	gfloat value;
+	guint i;
+	guint j;
+
+	for (i = start; i < end; i++) {
+		src = data + i - half_length;
+		value = 0;
+		for (j = 0; j < length_kernel; j++)
+			value += src[j] * kernel[j];
+		result[i] = value;
+	}
+}
+
+#ifdef GPM_ARRAY_FLOAT_HAVE_X86
+__attribute__((target("sse2")))
+static void
+gpm_array_float_convolve_body_sse2 (const gfloat *data, const gfloat *kernel,
+				    guint length_kernel, guint half_length,
+				    gfloat *result, guint start, guint end)
+{
+	const gfloat *src;
+	__m128 acc;
+	guint i;
+	guint j;
+
+	/* four outputs at a time, each lane summing the taps in order */
+	for (i = start; i + 4 <= end; i += 4) {
+		src = data + i - half_length;
+		acc = _mm_setzero_ps ();
+		for (j = 0; j < length_kernel; j++) {
+			acc = _mm_add_ps (acc, _mm_mul_ps (_mm_loadu_ps (src + j),
+							   _mm_set1_ps (kernel[j])));
+		}
+		_mm_storeu_ps (result + i, acc);
+	}
+	gpm_array_float_convolve_body_scalar (data, kernel, length_kernel,
+					      half_length, result, i, end);
+}
+
+__attribute__((target("avx2")))
+static void
+gpm_array_float_convolve_body_avx2 (const gfloat *data, const gfloat *kernel,
+				    guint length_kernel, guint half_length,
+				    gfloat *result, guint start, guint end)
+{
+	const gfloat *src;
+	__m256 acc;
+	guint i;
+	guint j;
+
+	/* eight outputs at a time, each lane summing the taps in order */
+	for (i = start; i + 8 <= end; i += 8) {
+		src = data + i - half_length;
+		acc = _mm256_setzero_ps ();
+		for (j = 0; j < length_kernel; j++) {
+			acc = _mm256_add_ps (acc, _mm256_mul_ps (_mm256_loadu_ps (src + j),
+								 _mm256_set1_ps (kernel[j])));
+		}
+		_mm256_storeu_ps (result + i, acc);
+	}
+	gpm_array_float_convolve_body_scalar (data, kernel, length_kernel,
+					      half_length, result, i, end);
+}
+#endif
+
+#ifdef GPM_ARRAY_FLOAT_HAVE_NEON
+static void
+gpm_array_float_convolve_body_neon (const gfloat *data, const gfloat *kernel,
+				    guint length_kernel, guint half_length,
+				    gfloat *result, guint start, guint end)
+{
+	const gfloat *src;
+	float32x4_t acc;
+	guint i;
+	guint j;
+
+	/* four outputs at a time, each lane summing the taps in order */
+	for (i = start; i + 4 <= end; i += 4) {
+		src = data + i - half_length;
+		acc = vdupq_n_f32 (0.f);
+		for (j = 0; j < length_kernel; j++)
+			acc = vaddq_f32 (acc, vmulq_n_f32 (vld1q_f32 (src + j), kernel[j]));
+		vst1q_f32 (result + i, acc);
+	}
+	gpm_array_float_convolve_body_scalar (data, kernel, length_kernel,
+					      half_length, result, i, end);
+}
+#endif
+
 /**
- * gpm_array_float_convolve:
+ * gpm_array_float_simd_is_supported:
+ * @simd: a #GpmArrayFloatSimd
  *
- * @data: input array
- * @kernel: kernel array
- * Return value: Colvolved array, same length as data
+ * Return value: %TRUE if the engine was built in and the CPU can run it
+ **/
+gboolean
+gpm_array_float_simd_is_supported (GpmArrayFloatSimd simd)
+{
+	switch (simd) {
+	case GPM_ARRAY_FLOAT_SIMD_NONE:
+		return TRUE;
+#ifdef GPM_ARRAY_FLOAT_HAVE_X86
+	case GPM_ARRAY_FLOAT_SIMD_SSE2:
+		return __builtin_cpu_supports ("sse2");
+	case GPM_ARRAY_FLOAT_SIMD_AVX2:
+		return __builtin_cpu_supports ("avx2");
+#endif
+#ifdef GPM_ARRAY_FLOAT_HAVE_NEON
+	case GPM_ARRAY_FLOAT_SIMD_NEON:
+		return TRUE;
+#endif
+	default:
+		return FALSE;
+	}
+}
+
+/**
+ * gpm_array_float_simd_get_best:
  *
- * Convolves an array with a kernel, and returns an array the same size.
- * THIS FUNCTION IS REALLY SLOW...
+ * Return value: the fastest convolution engine this machine supports
  **/
-GpmArrayFloat *
-gpm_array_float_convolve (GpmArrayFloat *data, GpmArrayFloat *kernel)
+GpmArrayFloatSimd
+gpm_array_float_simd_get_best (void)
+{
+	static GpmArrayFloatSimd best = GPM_ARRAY_FLOAT_SIMD_LAST;
+
+	if (best != GPM_ARRAY_FLOAT_SIMD_LAST)
+		return best;
+	if (gpm_array_float_simd_is_supported (GPM_ARRAY_FLOAT_SIMD_AVX2))
+		best = GPM_ARRAY_FLOAT_SIMD_AVX2;
+	else if (gpm_array_float_simd_is_supported (GPM_ARRAY_FLOAT_SIMD_SSE2))
+		best = GPM_ARRAY_FLOAT_SIMD_SSE2;
+	else if (gpm_array_float_simd_is_supported (GPM_ARRAY_FLOAT_SIMD_NEON))
+		best = GPM_ARRAY_FLOAT_SIMD_NEON;
+	else
+		best = GPM_ARRAY_FLOAT_SIMD_NONE;
+	g_debug ("using %s convolution", gpm_array_float_simd_to_string (best));
+	return best;
+}
+
+/**
+ * gpm_array_float_simd_to_string:
+ * @simd: a #GpmArrayFloatSimd
+ *
+ * Return value: a printable name for the engine
+ **/
+const gchar *
+gpm_array_float_simd_to_string (GpmArrayFloatSimd simd)
+{
+	switch (simd) {
+	case GPM_ARRAY_FLOAT_SIMD_NONE:
+		return "scalar";
+	case GPM_ARRAY_FLOAT_SIMD_SSE2:
+		return "sse2";
+	case GPM_ARRAY_FLOAT_SIMD_AVX2:
+		return "avx2";
+	case GPM_ARRAY_FLOAT_SIMD_NEON:
+		return "neon";
+	default:
+		return "unknown";
+	}
+}
+
+static GpmArrayFloatConvolveFunc
+gpm_array_float_simd_get_convolve_func (GpmArrayFloatSimd simd)
+{
+	if (!gpm_array_float_simd_is_supported (simd))
+		return gpm_array_float_convolve_body_scalar;
+	switch (simd) {
+#ifdef GPM_ARRAY_FLOAT_HAVE_X86
+	case GPM_ARRAY_FLOAT_SIMD_SSE2:
+		return gpm_array_float_convolve_body_sse2;
+	case GPM_ARRAY_FLOAT_SIMD_AVX2:
+		return gpm_array_float_convolve_body_avx2;
+#endif
+#ifdef GPM_ARRAY_FLOAT_HAVE_NEON
+	case GPM_ARRAY_FLOAT_SIMD_NEON:
+		return gpm_array_float_convolve_body_neon;
+#endif
+	default:
+		return gpm_array_float_convolve_body_scalar;
+	}
+}
+
+/* the slow path, where some of the taps fall off either end of the data */
+static void
+gpm_array_float_convolve_clamped (GpmArrayFloat *data, GpmArrayFloat *kernel,
+				  GpmArrayFloat *result, gint start, gint end)
 {
 	gint length_data;
 	gint length_kernel;
-	GpmArrayFloat *result;
 	gfloat value;
 	gint i;
 	gint j;
@@ -223,13 +625,9 @@ gpm_array_float_convolve (GpmArrayFloat *data, GpmArrayFloat *kernel)
 
 	length_data = data->len;
 	length_kernel = kernel->len;
-
-	result = gpm_array_float_new (length_data);
-
-	/* convolve */
-	for (i=0;i<length_data;i++) {
+	for (i = start; i < end; i++) {
 		value = 0;
-		for (j=0;j<length_kernel;j++) {
+		for (j = 0; j < length_kernel; j++) {
 			idx = i+j-(length_kernel/2);
 			if (idx < 0)
 				idx = 0;
@@ -239,9 +637,74 @@ gpm_array_float_convolve (GpmArrayFloat *data, GpmArrayFloat *kernel)
 		}
 		g_array_index (result, gfloat, i) = value;
 	}
+}
+
+/**
+ * gpm_array_float_convolve_simd:
+ *
+ * @data: input array
+ * @kernel: kernel array
+ * @simd: the engine to use for the unclamped middle section
+ * Return value: Colvolved array, same length as data
+ *
+ * Convolves an array with a kernel, and returns an array the same size.
+ * The head and tail of the data are clamped to the end values, and the
+ * middle section where every tap is in range is done without branches.
+ **/
+GpmArrayFloat *
+gpm_array_float_convolve_simd (GpmArrayFloat *data, GpmArrayFloat *kernel,
+			       GpmArrayFloatSimd simd)
+{
+	GpmArrayFloatConvolveFunc func;
+	GpmArrayFloat *result;
+	guint length_data;
+	guint length_kernel;
+	guint half_length;
+	guint middle_start;
+	guint middle_end;
+
+	length_data = data->len;
+	length_kernel = kernel->len;
+	half_length = length_kernel / 2;
+
+	result = gpm_array_float_new (length_data);
+
+	/* no taps can be taken without clamping */
+	if (length_kernel == 0 || length_data < length_kernel) {
+		gpm_array_float_convolve_clamped (data, kernel, result, 0, length_data);
+		return result;
+	}
+
+	middle_start = half_length;
+	middle_end = length_data - length_kernel + half_length + 1;
+
+	/* convolve */
+	gpm_array_float_convolve_clamped (data, kernel, result, 0, middle_start);
+	func = gpm_array_float_simd_get_convolve_func (simd);
+	func ((const gfloat *) data->data, (const gfloat *) kernel->data,
+	      length_kernel, half_length,
+	      (gfloat *) result->data, middle_start, middle_end);
+	gpm_array_float_convolve_clamped (data, kernel, result, middle_end, length_data);
 	return result;
 }
 
+/**
+ * gpm_array_float_convolve:
+ *
+ * @data: input array
+ * @kernel: kernel array
+ * Return value: Colvolved array, same length as data
+ *
+ * Convolves an array with a kernel, and returns an array the same size,
+ * using the fastest engine the CPU supports.
+ **/
+GpmArrayFloat *
+gpm_array_float_convolve (GpmArrayFloat *data, GpmArrayFloat *kernel)
+{
+	return gpm_array_float_convolve_simd (data, kernel,
+					      gpm_array_float_simd_get_best ());
+}
+
 /**
  * gpm_array_float_compute_integral:
  * @array: This class instance
@@ -256,6 +719,7 @@ gpm_array_float_compute_integral (GpmArrayFloat *array, guint x1, guint x2)
 	guint i;
 
 	g_return_val_if_fail (x2 >= x1, 0.0);
+	g_return_val_if_fail (x2 < array->len, 0.0);
 
 	/* if the same point, then we have no area */
 	if (x1 == x2)
@@ -267,14 +731,88 @@ gpm_array_float_compute_integral (GpmArrayFloat *array, guint x1, guint x2)
 	return value;
 }
 
-static gfloat
-powfi (gfloat base, guint n)
+/**
+ * gpm_array_float_get_range_average:
+ * @array: This class instance
+ * @x1: the first index
+ * @x2: the last index, inclusive
+ *
+ * Gets the average value between two points.
+ **/
+gfloat
+gpm_array_float_get_range_average (GpmArrayFloat *array, guint x1, guint x2)
 {
+	gdouble total = 0.0;
 	guint i;
-	gfloat retval = 1;
-	for (i=1; i <= n; i++)
-		retval *= base;
-	return retval;
+
+	g_return_val_if_fail (x2 >= x1, 0.0);
+	g_return_val_if_fail (x2 < array->len, 0.0);
+
+	for (i = x1; i <= x2; i++)
+		total += g_array_index (array, gfloat, i);
+	return total / (x2 - x1 + 1);
+}
+
+/* Neumaier compensated sum, so a running total does not drift */
+typedef struct {
+	gdouble		 sum;
+	gdouble		 compensation;
+} GpmArrayFloatAccumulator;
+
+static void
+gpm_array_float_accumulator_add (GpmArrayFloatAccumulator *acc, gdouble value)
+{
+	gdouble total = acc->sum + value;
+	if (fabs (acc->sum) >= fabs (value))
+		acc->compensation += (acc->sum - total) + value;
+	else
+		acc->compensation += (value - total) + acc->sum;
+	acc->sum = total;
+}
+
+static gdouble
+gpm_array_float_accumulator_get (GpmArrayFloatAccumulator *acc)
+{
+	return acc->sum + acc->compensation;
+}
+
+/* monotonic queue of indices, giving the extreme value of a sliding window */
+typedef struct {
+	guint		*idx;
+	guint		 size;
+	guint		 head;
+	guint		 len;
+	gboolean	 is_max;
+} GpmArrayFloatWindow;
+
+static void
+gpm_array_float_window_push (GpmArrayFloatWindow *window, const gfloat *data,
+			     guint i, guint window_start)
+{
+	guint back;
+
+	/* drop anything that has left the window */
+	while (window->len > 0 && window->idx[window->head] < window_start) {
+		window->head = (window->head + 1) % window->size;
+		window->len--;
+	}
+
+	/* drop anything that can never be the extreme again, keeping equal
+	 * values so the first occurrence wins like the full rescan did */
+	while (window->len > 0) {
+		back = window->idx[(window->head + window->len - 1) % window->size];
+		if (window->is_max ? data[back] >= data[i] : data[back] <= data[i])
+			break;
+		window->len--;
+	}
+	window->idx[(window->head + window->len) % window->size] = i;
+	window->len++;
+}
+
+static guint
+gpm_array_float_window_get (GpmArrayFloatWindow *window)
+{
+	return window->idx[window->head];
 }
 
 /**
@@ -287,74 +825,103 @@ powfi (gfloat base, guint n)
  *
  * Compares local sections of the data, removing outliers if they fall
  * ouside of sigma, and using the average of the other points in it's place.
+ *
+ * The window sums and extremes are kept up to date as the window slides,
+ * so this is linear in the length of the data whatever the window size.
+ * If the data is shorter than the window it is returned unchanged.
  **/
 GpmArrayFloat *
 gpm_array_float_remove_outliers (GpmArrayFloat *data, guint length, gfloat sigma)
 {
 	guint i;
-	guint j;
 	guint half_length;
-	gfloat value;
-	gfloat average;
-	gfloat average_not_inc;
-	gfloat average_square;
-	gfloat biggest_difference;
-	gfloat outlier_value;
+	guint idx_max;
+	guint idx_min;
+	const gfloat *values;
+	gdouble value;
+	gdouble average;
+	gdouble average_square;
+	gdouble diff_max;
+	gdouble diff_min;
+	gdouble outlier_value;
+	GpmArrayFloatAccumulator sum = { 0.0, 0.0 };
+	GpmArrayFloatAccumulator sum_square = { 0.0, 0.0 };
+	GpmArrayFloatWindow window_max = { NULL, 0, 0, 0, TRUE };
+	GpmArrayFloatWindow window_min = { NULL, 0, 0, 0, FALSE };
 	GpmArrayFloat *result;
 
 	g_return_val_if_fail (length % 2 == 1, NULL);
 	result = gpm_array_float_new (data->len);
 
-	/* check for no data */
-	if (data->len == 0)
+	/* not enough data to fill a window, or nothing to leave out */
+	if (data->len < length || length == 1) {
+		for (i = 0; i < data->len; i++)
+			g_array_index (result, gfloat, i) = g_array_index (data, gfloat, i);
 		goto out;
+	}
 
+	values = (const gfloat *) data->data;
 	half_length = (length - 1) / 2;
 
 	/* copy start and end of array */
 	for (i=0; i < half_length; i++)
-		g_array_index (result, gfloat, i) = g_array_index (data, gfloat, i);
+		g_array_index (result, gfloat, i) = values[i];
 	for (i=data->len-half_length; i < data->len; i++)
-		g_array_index (result, gfloat, i) = g_array_index (data, gfloat, i);
+		g_array_index (result, gfloat, i) = values[i];
+
+	/* prime the window with all but the last point of the first block */
+	window_max.size = window_min.size = length;
+	window_max.idx = g_new (guint, length);
+	window_min.idx = g_new (guint, length);
+	for (i = 0; i < length - 1; i++) {
+		gpm_array_float_accumulator_add (&sum, values[i]);
+		gpm_array_float_accumulator_add (&sum_square, (gdouble) values[i] * values[i]);
+		gpm_array_float_window_push (&window_max, values, i, 0);
+		gpm_array_float_window_push (&window_min, values, i, 0);
+	}
 
 	/* find the standard deviation of a block off data */
 	for (i=half_length; i < data->len-half_length; i++) {
-		average = 0;
-		average_square = 0;
-
-		/* find the average and the squared average */
-		for (j=i-half_length; j<i+half_length+1; j++) {
-			value = g_array_index (data, gfloat, j);
-			average += value;
-			average_square += powfi (value, 2);
-		}
+
+		/* add the point entering the block */
+		value = values[i + half_length];
+		gpm_array_float_accumulator_add (&sum, value);
+		gpm_array_float_accumulator_add (&sum_square, value * value);
+		gpm_array_float_window_push (&window_max, values, i + half_length, i - half_length);
+		gpm_array_float_window_push (&window_min, values, i + half_length, i - half_length);
 
 		/* divide by length to get average */
-		average /= length;
-		average_square /= length;
+		average = gpm_array_float_accumulator_get (&sum) / length;
+		average_square = gpm_array_float_accumulator_get (&sum_square) / length;
 
 		/* find the standard deviation */
-		value = sqrtf (average_square - powfi (average, 2));
+		value = sqrt (MAX (average_square - average * average, 0.0));
 
 		/* stddev is okay */
 		if (value < sigma) {
-			g_array_index (result, gfloat, i) = g_array_index (data, gfloat, i);
+			g_array_index (result, gfloat, i) = values[i];
 		} else {
-			/* ignore the biggest difference from the average */
-			biggest_difference = 0;
-			outlier_value = 0;
-			for (j=i-half_length; j<i+half_length+1; j++) {
-				value = fabs (g_array_index (data, gfloat, j) - average);
-				if (value > biggest_difference) {
-					biggest_difference = value;
-					outlier_value = g_array_index (data, gfloat, j);
-				}
-			}
-			average_not_inc = (average * length) - outlier_value;
-			average_not_inc /= length - 1;
-			g_array_index (result, gfloat, i) = average_not_inc;
+			/* ignore the biggest difference from the average, which
+			 * has to be either the biggest or smallest value */
+			idx_max = gpm_array_float_window_get (&window_max);
+			idx_min = gpm_array_float_window_get (&window_min);
+			diff_max = fabs (values[idx_max] - average);
+			diff_min = fabs (values[idx_min] - average);
+			if (diff_max > diff_min || (diff_max == diff_min && idx_max < idx_min))
+				outlier_value = diff_max > 0 ? values[idx_max] : 0;
+			else
+				outlier_value = diff_min > 0 ? values[idx_min] : 0;
+			value = gpm_array_float_accumulator_get (&sum) - outlier_value;
+			g_array_index (result, gfloat, i) = value / (length - 1);
 		}
+
+		/* remove the point leaving the block */
+		value = values[i - half_length];
+		gpm_array_float_accumulator_add (&sum, -value);
+		gpm_array_float_accumulator_add (&sum_square, -(value * value));
 	}
+	g_free (window_max.idx);
+	g_free (window_min.idx);
 out:
 	return result;
 }
@@ -29,18 +29,49 @@ G_BEGIN_DECLS
 /* at the moment just use a GArray as it's quick */
 typedef GArray GpmArrayFloat;
 
+/* cumulative sums for constant time range queries */
+typedef struct _GpmArrayFloatIndex GpmArrayFloatIndex;
+
+typedef enum {
+	GPM_ARRAY_FLOAT_SIMD_NONE,
+	GPM_ARRAY_FLOAT_SIMD_SSE2,
+	GPM_ARRAY_FLOAT_SIMD_AVX2,
+	GPM_ARRAY_FLOAT_SIMD_NEON,
+	GPM_ARRAY_FLOAT_SIMD_LAST
+} GpmArrayFloatSimd;
+
 GpmArrayFloat	*gpm_array_float_new			(guint		 length);
 void		 gpm_array_float_free			(GpmArrayFloat	*array);
 gfloat		 gpm_array_float_sum			(GpmArrayFloat	*array);
 GpmArrayFloat	*gpm_array_float_compute_gaussian	(guint		 length,
 							 gfloat		 sigma);
+GpmArrayFloat	*gpm_array_float_get_gaussian		(guint		 length,
+							 gfloat		 sigma);
 gfloat		 gpm_array_float_compute_integral	(GpmArrayFloat	*array,
 							 guint		 x1,
 							 guint		 x2);
 gfloat		 gpm_array_float_get_average		(GpmArrayFloat	*array);
+gfloat		 gpm_array_float_get_range_average	(GpmArrayFloat	*array,
+							 guint		 x1,
+							 guint		 x2);
+GpmArrayFloatIndex *gpm_array_float_index_new		(GpmArrayFloat	*array);
+void		 gpm_array_float_index_free		(GpmArrayFloatIndex *idx);
+void		 gpm_array_float_index_invalidate	(GpmArrayFloatIndex *idx);
+gfloat		 gpm_array_float_index_compute_integral	(GpmArrayFloatIndex *idx,
+							 guint		 x1,
+							 guint		 x2);
+gfloat		 gpm_array_float_index_get_range_average (GpmArrayFloatIndex *idx,
+							 guint		 x1,
+							 guint		 x2);
 gboolean	 gpm_array_float_print			(GpmArrayFloat	*array);
 GpmArrayFloat	*gpm_array_float_convolve		(GpmArrayFloat	*data,
 							 GpmArrayFloat	*kernel);
+GpmArrayFloat	*gpm_array_float_convolve_simd		(GpmArrayFloat	*data,
+							 GpmArrayFloat	*kernel,
+							 GpmArrayFloatSimd simd);
+GpmArrayFloatSimd gpm_array_float_simd_get_best		(void);
+gboolean	 gpm_array_float_simd_is_supported	(GpmArrayFloatSimd simd);
+const gchar	*gpm_array_float_simd_to_string		(GpmArrayFloatSimd simd);
 gfloat		 gpm_array_float_get			(GpmArrayFloat	*array,
 							 guint		 i);
 void		 gpm_array_float_set			(GpmArrayFloat	*array,
@@ -0,0 +1,235 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The GNOME Power Manager authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <libupower-glib/upower.h>
+
+#include "gpm-history-cache.h"
+
+/* once tail refreshes have doubled the point count, fetch it all again */
+#define GPM_HISTORY_CACHE_MAX_GROWTH	2
+
+struct _GpmHistoryCache
+{
+	GHashTable	*entries;	/* key: object path, value: GHashTable */
+};
+
+typedef struct {
+	GPtrArray	*items;		/* of UpHistoryItem, newest first */
+	guint		 resolution;
+	guint		 newest;
+} GpmHistoryCacheEntry;
+
+static void
+gpm_history_cache_entry_free (GpmHistoryCacheEntry *entry)
+{
+	g_ptr_array_unref (entry->items);
+	g_free (entry);
+}
+
+/**
+ * gpm_history_cache_new:
+ *
+ * Creates a cache of device history, keyed by the device object path,
+ * the history type and the timespan.
+ **/
+GpmHistoryCache *
+gpm_history_cache_new (void)
+{
+	GpmHistoryCache *cache;
+	cache = g_new0 (GpmHistoryCache, 1);
+	cache->entries = g_hash_table_new_full (g_str_hash, g_str_equal,
+						g_free, (GDestroyNotify) g_hash_table_unref);
+	return cache;
+}
+
+void
+gpm_history_cache_free (GpmHistoryCache *cache)
+{
+	if (cache == NULL)
+		return;
+	g_hash_table_unref (cache->entries);
+	g_free (cache);
+}
+
+static gchar *
+gpm_history_cache_get_key (const gchar *type, guint timespan)
+{
+	return g_strdup_printf ("%s:%u", type, timespan);
+}
+
+static GpmHistoryCacheEntry *
+gpm_history_cache_get_entry (GpmHistoryCache *cache,
+			     const gchar *object_path,
+			     const gchar *type,
+			     guint timespan)
+{
+	GHashTable *device;
+	g_autofree gchar *key = NULL;
+
+	device = g_hash_table_lookup (cache->entries, object_path);
+	if (device == NULL)
+		return NULL;
+	key = gpm_history_cache_get_key (type, timespan);
+	return g_hash_table_lookup (device, key);
+}
+
+/**
+ * gpm_history_cache_lookup:
+ * @newest: (out): the time of the newest cached sample
+ *
+ * Gets the cached history, as long as it was fetched at the same or a
+ * finer resolution and has not grown too far past it.
+ *
+ * Return value: (transfer container): an array of #UpHistoryItem, or %NULL
+ **/
+GPtrArray *
+gpm_history_cache_lookup (GpmHistoryCache *cache,
+			  const gchar *object_path,
+			  const gchar *type,
+			  guint timespan,
+			  guint resolution,
+			  guint *newest)
+{
+	GpmHistoryCacheEntry *entry;
+
+	g_return_val_if_fail (cache != NULL, NULL);
+
+	entry = gpm_history_cache_get_entry (cache, object_path, type, timespan);
+	if (entry == NULL)
+		return NULL;
+	if (entry->resolution < resolution)
+		return NULL;
+	if (entry->items->len > entry->resolution * GPM_HISTORY_CACHE_MAX_GROWTH)
+		return NULL;
+	if (newest != NULL)
+		*newest = entry->newest;
+	return g_ptr_array_ref (entry->items);
+}
+
+static gint
+gpm_history_cache_sort_cb (gconstpointer a, gconstpointer b)
+{
+	UpHistoryItem *item1 = *((UpHistoryItem **) a);
+	UpHistoryItem *item2 = *((UpHistoryItem **) b);
+	guint time1 = up_history_item_get_time (item1);
+	guint time2 = up_history_item_get_time (item2);
+
+	/* newest first, like upowerd returns it */
+	if (time1 > time2)
+		return -1;
+	if (time1 < time2)
+		return 1;
+	return 0;
+}
+
+/**
+ * gpm_history_cache_add:
+ * @items: the history returned by UPower
+ * @replace: %TRUE if @items is the whole timespan, %FALSE if it is a tail
+ * @now: the current time, in seconds since the epoch
+ *
+ * Stores the history, either as a whole or by merging in the samples newer
+ * than those already cached. Samples that have fallen out of the timespan
+ * are dropped.
+ *
+ * Return value: (transfer container): the merged array of #UpHistoryItem
+ **/
+GPtrArray *
+gpm_history_cache_add (GpmHistoryCache *cache,
+		       const gchar *object_path,
+		       const gchar *type,
+		       guint timespan,
+		       guint resolution,
+		       GPtrArray *items,
+		       gboolean replace,
+		       guint now)
+{
+	GHashTable *device;
+	GpmHistoryCacheEntry *entry;
+	GPtrArray *array;
+	UpHistoryItem *item;
+	guint oldest;
+	guint newest = 0;
+	guint timestamp;
+	guint i;
+
+	g_return_val_if_fail (cache != NULL, NULL);
+	g_return_val_if_fail (items != NULL, NULL);
+
+	device = g_hash_table_lookup (cache->entries, object_path);
+	if (device == NULL) {
+		device = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+						(GDestroyNotify) gpm_history_cache_entry_free);
+		g_hash_table_insert (cache->entries, g_strdup (object_path), device);
+	}
+	entry = gpm_history_cache_get_entry (cache, object_path, type, timespan);
+	if (entry != NULL && !replace)
+		newest = entry->newest;
+
+	/* keep anything still in range, then anything new */
+	oldest = now > timespan ? now - timespan : 0;
+	array = g_ptr_array_new_full (items->len, (GDestroyNotify) g_object_unref);
+	if (entry != NULL && !replace) {
+		for (i = 0; i < entry->items->len; i++) {
+			item = g_ptr_array_index (entry->items, i);
+			if (up_history_item_get_time (item) > oldest)
+				g_ptr_array_add (array, g_object_ref (item));
+		}
+	}
+	for (i = 0; i < items->len; i++) {
+		item = g_ptr_array_index (items, i);
+		timestamp = up_history_item_get_time (item);
+		if (timestamp <= newest || timestamp <= oldest)
+			continue;
+		g_ptr_array_add (array, g_object_ref (item));
+	}
+	g_ptr_array_sort (array, gpm_history_cache_sort_cb);
+
+	if (entry == NULL) {
+		entry = g_new0 (GpmHistoryCacheEntry, 1);
+		g_hash_table_insert (device, gpm_history_cache_get_key (type, timespan), entry);
+	} else {
+		g_ptr_array_unref (entry->items);
+	}
+	entry->items = array;
+	entry->resolution = resolution;
+	entry->newest = newest;
+	if (array->len > 0) {
+		item = g_ptr_array_index (array, 0);
+		entry->newest = MAX (newest, up_history_item_get_time (item));
+	}
+	return g_ptr_array_ref (array);
+}
+
+/**
+ * gpm_history_cache_invalidate:
+ *
+ * Forgets everything cached for the device, e.g. when it is removed.
+ **/
+void
+gpm_history_cache_invalidate (GpmHistoryCache *cache, const gchar *object_path)
+{
+	g_return_if_fail (cache != NULL);
+	g_hash_table_remove (cache->entries, object_path);
+}
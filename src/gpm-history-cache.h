@@ -0,0 +1,54 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The GNOME Power Manager authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __GPM_HISTORY_CACHE_H
+#define __GPM_HISTORY_CACHE_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GpmHistoryCache GpmHistoryCache;
+
+GpmHistoryCache	*gpm_history_cache_new			(void);
+void		 gpm_history_cache_free			(GpmHistoryCache	*cache);
+GPtrArray	*gpm_history_cache_lookup		(GpmHistoryCache	*cache,
+							 const gchar		*object_path,
+							 const gchar		*type,
+							 guint			 timespan,
+							 guint			 resolution,
+							 guint			*newest);
+GPtrArray	*gpm_history_cache_add			(GpmHistoryCache	*cache,
+							 const gchar		*object_path,
+							 const gchar		*type,
+							 guint			 timespan,
+							 guint			 resolution,
+							 GPtrArray		*items,
+							 gboolean		 replace,
+							 guint			 now);
+void		 gpm_history_cache_invalidate		(GpmHistoryCache	*cache,
+							 const gchar		*object_path);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (GpmHistoryCache, gpm_history_cache_free)
+
+G_END_DECLS
+
+#endif /* __GPM_HISTORY_CACHE_H */
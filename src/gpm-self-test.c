@@ -26,7 +26,13 @@
 #include <glib-object.h>
 #include <gtk/gtk.h>
 
+#include <libupower-glib/upower.h>
+
+#include "egg-graph-series.h"
+#include "egg-graph-widget.h"
 #include "gpm-array-float.h"
+#include "gpm-history-cache.h"
+#include "gpm-stats-cache.h"
 
 static void
 gpm_test_array_float_func (void)
@@ -34,6 +40,7 @@ gpm_test_array_float_func (void)
 	GpmArrayFloat *array;
 	GpmArrayFloat *kernel;
 	GpmArrayFloat *result;
+	GpmArrayFloatIndex *idx;
 	gfloat value;
 	gfloat sigma;
 	guint size;
@@ -97,6 +104,14 @@ gpm_test_array_float_func (void)
 	g_assert_cmpfloat (fabs(value - 80), <, 1.0f);
 	gpm_array_float_free (kernel);
 
+	/* remove outliers with a window wider than the data */
+	kernel = gpm_array_float_remove_outliers (array, 101, 1.0);
+	g_assert (kernel != NULL);
+	g_assert_cmpint (kernel->len, ==, 10);
+	for (size = 0; size < 10; size++)
+		g_assert_cmpfloat (gpm_array_float_get (kernel, size), ==, gpm_array_float_get (array, size));
+	gpm_array_float_free (kernel);
+
 	/* get gaussian 0.0, sigma 1.1 */
 	value = gpm_array_float_guassian_value (0.0, 1.1);
 	g_assert_cmpfloat (fabs (value - 0.36267), <, 0.0001f);
@@ -131,6 +146,28 @@ gpm_test_array_float_func (void)
 	value = gpm_array_float_sum (kernel);
 	g_assert_cmpfloat (fabs(value - 1.0), <, 0.01f);
 
+	/* get the shared gaussian-9 array */
+	result = gpm_array_float_get_gaussian (size, sigma);
+	g_assert (result != NULL);
+	g_assert_cmpint (result->len, ==, size);
+	value = gpm_array_float_sum (result);
+	g_assert_cmpfloat (fabs (value - 1.0), <, 0.00001f);
+	g_assert (gpm_array_float_get_gaussian (size, sigma) == result);
+	gpm_array_float_free (result);
+	g_assert_cmpint (result->len, ==, size);
+	gpm_array_float_free (result);
+
+	/* different sigma gets a different array */
+	result = gpm_array_float_get_gaussian (size, 1.2);
+	g_assert (result != NULL);
+	g_assert (gpm_array_float_get_gaussian (size, sigma) != result);
+	gpm_array_float_free (gpm_array_float_get_gaussian (size, sigma));
+	gpm_array_float_free (result);
+
+	/* get inprecise shared gaussian array */
+	result = gpm_array_float_get_gaussian (5, 1.1);
+	g_assert (result == NULL);
+
 	/* make sure we get get and set */
 	gpm_array_float_set (array, 4, 100.0);
 	value = gpm_array_float_get (array, 4);
@@ -280,6 +317,28 @@ gpm_test_array_float_func (void)
 	size = gpm_array_float_compute_integral (array, 0, 9);
 	g_assert_cmpint (size, ==, 0+1+2+3+4+5+6+7+8+9);
 
+	/* integration using the index */
+	idx = gpm_array_float_index_new (array);
+	size = gpm_array_float_index_compute_integral (idx, 0, 4);
+	g_assert_cmpint (size, ==, 0+1+2+3+4);
+	size = gpm_array_float_index_compute_integral (idx, 5, 9);
+	g_assert_cmpint (size, ==, 5+6+7+8+9);
+	value = gpm_array_float_index_get_range_average (idx, 2, 4);
+	g_assert_cmpfloat (value, ==, 3.0f);
+	value = gpm_array_float_get_range_average (array, 2, 4);
+	g_assert_cmpfloat (value, ==, 3.0f);
+
+	/* the sums are rebuilt once invalidated */
+	gpm_array_float_set (array, 3, 100.0);
+	gpm_array_float_index_invalidate (idx);
+	size = gpm_array_float_index_compute_integral (idx, 0, 4);
+	g_assert_cmpint (size, ==, 0+1+2+100+4);
+	value = gpm_array_float_index_get_range_average (idx, 3, 3);
+	g_assert_cmpfloat (value, ==, 100.0f);
+	gpm_array_float_index_free (idx);
+	size = gpm_array_float_compute_integral (array, 0, 4);
+	g_assert_cmpint (size, ==, 0+1+2+100+4);
+
 	/* average */
 	gpm_array_float_set (array, 0, 0.0);
 	gpm_array_float_set (array, 1, 1.0);
@@ -299,6 +358,493 @@ gpm_test_array_float_func (void)
 	gpm_array_float_free (kernel);
 }
 
+static void
+gpm_test_array_float_outliers_func (void)
+{
+	GpmArrayFloat *array;
+	GpmArrayFloat *result;
+	gfloat value;
+	guint i;
+
+	/* a long noisy series with a big offset and a single spike */
+	array = gpm_array_float_new (20000);
+	for (i = 0; i < array->len; i++)
+		gpm_array_float_set (array, i, 1000000.0 + (i % 2 == 0 ? 0.5 : -0.5));
+	gpm_array_float_set (array, 10000, 1001000.0);
+
+	/* wide window, so the spike has to be replaced */
+	result = gpm_array_float_remove_outliers (array, 1001, 10.0);
+	g_assert (result != NULL);
+	g_assert_cmpint (result->len, ==, array->len);
+	value = gpm_array_float_get (result, 10000);
+	g_assert_cmpfloat (fabs (value - 1000000.0), <, 1.0f);
+
+	/* the running sums must not drift away from the quiet data */
+	g_assert_cmpfloat (gpm_array_float_get (result, 0), ==, gpm_array_float_get (array, 0));
+	g_assert_cmpfloat (gpm_array_float_get (result, 19999), ==, gpm_array_float_get (array, 19999));
+	for (i = 0; i < array->len; i += 997) {
+		if (i > 9500 && i < 10500)
+			continue;
+		g_assert_cmpfloat (gpm_array_float_get (result, i), ==, gpm_array_float_get (array, i));
+	}
+	gpm_array_float_free (result);
+	gpm_array_float_free (array);
+
+	/* the maximum and minimum are as far from the average, and both
+	 * repeat, so the first of them in the window has to be dropped */
+	array = gpm_array_float_new (5);
+	gpm_array_float_set (array, 0, 10.0);
+	gpm_array_float_set (array, 1, 0.0);
+	gpm_array_float_set (array, 2, 0.0);
+	gpm_array_float_set (array, 3, 10.0);
+	gpm_array_float_set (array, 4, 5.0);
+	result = gpm_array_float_remove_outliers (array, 5, 1.0);
+	g_assert_cmpfloat (gpm_array_float_get (result, 2), ==, 3.75);
+	gpm_array_float_free (result);
+	gpm_array_float_free (array);
+}
+
+static void
+gpm_test_array_float_convolve_func (void)
+{
+	GpmArrayFloat *data;
+	GpmArrayFloat *kernel;
+	GpmArrayFloat *expected;
+	GpmArrayFloat *result;
+	GpmArrayFloatSimd simd;
+	gfloat value;
+	guint lengths[] = { 0, 1, 7, 14, 15, 16, 17, 31, 150, 1001 };
+	guint kernels[] = { 9, 15 };
+	guint i;
+	guint j;
+	guint k;
+	guint l;
+
+	for (k = 0; k < G_N_ELEMENTS (kernels); k++) {
+		kernel = gpm_array_float_compute_gaussian (kernels[k], 1.1);
+		g_assert (kernel != NULL);
+		for (l = 0; l < G_N_ELEMENTS (lengths); l++) {
+			data = gpm_array_float_new (lengths[l]);
+			for (i = 0; i < data->len; i++)
+				gpm_array_float_set (data, i, g_test_rand_double_range (-100, 100));
+
+			/* every engine has to agree with the scalar one */
+			expected = gpm_array_float_convolve_simd (data, kernel, GPM_ARRAY_FLOAT_SIMD_NONE);
+			g_assert_cmpint (expected->len, ==, data->len);
+			for (simd = 0; simd < GPM_ARRAY_FLOAT_SIMD_LAST; simd++) {
+				if (!gpm_array_float_simd_is_supported (simd))
+					continue;
+				result = gpm_array_float_convolve_simd (data, kernel, simd);
+				g_assert_cmpint (result->len, ==, expected->len);
+				for (j = 0; j < result->len; j++) {
+					value = gpm_array_float_get (expected, j);
+					g_assert_cmpfloat (fabs (gpm_array_float_get (result, j) - value), <=,
+							   1e-5f * MAX (1.f, fabs (value)));
+				}
+				gpm_array_float_free (result);
+			}
+
+			/* the default engine */
+			result = gpm_array_float_convolve (data, kernel);
+			g_assert_cmpint (result->len, ==, expected->len);
+			gpm_array_float_free (result);
+
+			gpm_array_float_free (expected);
+			gpm_array_float_free (data);
+		}
+		gpm_array_float_free (kernel);
+	}
+
+	/* the scalar engine is always there */
+	g_assert (gpm_array_float_simd_is_supported (GPM_ARRAY_FLOAT_SIMD_NONE));
+	simd = gpm_array_float_simd_get_best ();
+	g_assert (gpm_array_float_simd_is_supported (simd));
+	g_assert (gpm_array_float_simd_to_string (simd) != NULL);
+}
+
+static void
+gpm_test_graph_series_func (void)
+{
+	EggGraphSeries *series;
+	EggGraphSeries *copy;
+	EggGraphPoint point;
+	GPtrArray *points;
+	gdouble *x;
+	guint i;
+
+	/* reserving up front means appending does not move the columns */
+	series = egg_graph_series_sized_new (1000);
+	g_assert_cmpint (series->len, ==, 0);
+	x = series->x;
+	for (i = 0; i < 1000; i++)
+		egg_graph_series_append (series, i, i * 2, 0xff0000);
+	g_assert (series->x == x);
+	g_assert_cmpint (series->len, ==, 1000);
+
+	/* and it still grows past that */
+	egg_graph_series_append (series, 1000, 2000, 0x0000ff);
+	g_assert_cmpint (series->len, ==, 1001);
+	egg_graph_series_get_point (series, 1000, &point);
+	g_assert_cmpfloat (point.x, ==, 1000);
+	g_assert_cmpfloat (point.y, ==, 2000);
+	g_assert_cmpint (point.color, ==, 0x0000ff);
+
+	/* bounds are kept as points are added */
+	g_assert_cmpfloat (series->min_x, ==, 0);
+	g_assert_cmpfloat (series->max_x, ==, 1000);
+	g_assert_cmpfloat (series->min_y, ==, 0);
+	g_assert_cmpfloat (series->max_y, ==, 2000);
+	egg_graph_series_append (series, -5, -1, 0x0000ff);
+	g_assert_cmpfloat (series->min_x, ==, -5);
+	g_assert_cmpfloat (series->min_y, ==, -1);
+	g_assert_cmpfloat (series->max_y, ==, 2000);
+
+	/* copies are deep */
+	copy = egg_graph_series_copy (series);
+	g_assert_cmpfloat (copy->min_x, ==, -5);
+	g_assert_cmpfloat (copy->max_x, ==, 1000);
+	g_assert_cmpint (copy->len, ==, series->len);
+	g_assert (copy->y != series->y);
+	g_assert_cmpfloat (copy->y[500], ==, 1000);
+	g_assert_cmpint (copy->color[500], ==, 0xff0000);
+	egg_graph_series_unref (copy);
+
+	/* refcounting keeps the columns alive */
+	copy = egg_graph_series_ref (series);
+	egg_graph_series_unref (series);
+	g_assert_cmpfloat (copy->x[1], ==, 1);
+	egg_graph_series_unref (copy);
+
+	/* from legacy points */
+	points = g_ptr_array_new_with_free_func ((GDestroyNotify) egg_graph_point_free);
+	for (i = 0; i < 10; i++) {
+		EggGraphPoint *tmp = egg_graph_point_new ();
+		tmp->x = i;
+		tmp->y = 10 - i;
+		g_ptr_array_add (points, tmp);
+	}
+	series = egg_graph_series_new_from_points (points);
+	g_assert_cmpint (series->len, ==, 10);
+	g_assert_cmpfloat (series->y[3], ==, 7);
+	egg_graph_series_unref (series);
+	g_ptr_array_unref (points);
+}
+
+static void
+gpm_test_graph_series_decimate_func (void)
+{
+	EggGraphSeries *series;
+	EggGraphSeries *result;
+	guint i;
+
+	/* a sawtooth with 100 points in each of 10 columns */
+	series = egg_graph_series_sized_new (1000);
+	for (i = 0; i < 1000; i++)
+		egg_graph_series_append (series, i, i % 7, 0xff0000);
+	result = egg_graph_series_decimate (series, 0, 1000, 0.01);
+	g_assert_cmpint (result->len, <=, 40);
+
+	/* first, highest and last of the first column, in order, as the
+	 * first point is also the lowest */
+	g_assert_cmpfloat (result->x[0], ==, 0);
+	g_assert_cmpfloat (result->x[1], ==, 6);
+	g_assert_cmpfloat (result->y[1], ==, 6);
+	g_assert_cmpfloat (result->x[2], ==, 99);
+	g_assert_cmpfloat (result->x[3], ==, 100);
+	i = result->len;
+	egg_graph_series_unref (result);
+
+	/* a color change always starts a new run */
+	series->color[50] = 0x0000ff;
+	result = egg_graph_series_decimate (series, 0, 1000, 0.01);
+	g_assert_cmpint (result->len, >, i);
+	for (i = 0; i < result->len; i++) {
+		if (result->x[i] == 50)
+			break;
+	}
+	g_assert_cmpint (i, <, result->len);
+	g_assert_cmpint (result->color[i], ==, 0x0000ff);
+	g_assert_cmpint (result->color[i - 1], ==, 0xff0000);
+	g_assert_cmpfloat (result->x[i - 1], ==, 49);
+	g_assert_cmpint (result->color[i + 1], ==, 0xff0000);
+	g_assert_cmpfloat (result->x[i + 1], ==, 51);
+	egg_graph_series_unref (result);
+
+	/* one point per column is left alone */
+	result = egg_graph_series_decimate (series, 0, 1000, 1);
+	g_assert_cmpint (result->len, ==, series->len);
+	egg_graph_series_unref (result);
+	egg_graph_series_unref (series);
+}
+
+static void
+gpm_test_graph_series_lod_func (void)
+{
+	EggGraphSeries *series;
+	EggGraphSeries *lod;
+	EggGraphSeries *tmp;
+	guint first, end;
+	guint i;
+
+	/* newest first, like the history */
+	series = egg_graph_series_sized_new (100000);
+	for (i = 0; i < 100000; i++)
+		egg_graph_series_append (series, -(gdouble) i, i % 100, 0xff0000);
+	g_assert (egg_graph_series_find_range (series, -200, -100, &first, &end));
+	g_assert_cmpint (first, ==, 100);
+	g_assert_cmpint (end, ==, 201);
+	g_assert (egg_graph_series_find_range (series, 10, 20, &first, &end));
+	g_assert_cmpint (first, ==, end);
+
+	/* zoomed out this is much smaller, but still has the full envelope */
+	lod = egg_graph_series_get_lod (series, -100000, 0, 1000);
+	g_assert (lod != series);
+	g_assert_cmpint (lod->len, <, series->len / 4);
+	g_assert (egg_graph_series_find_range (lod, -100000, 0, &first, &end));
+	g_assert_cmpint (end - first, >=, 1000);
+	g_assert_cmpfloat (lod->min_y, ==, 0);
+	g_assert_cmpfloat (lod->max_y, ==, 99);
+	g_assert_cmpfloat (lod->min_x, ==, -99999);
+	g_assert_cmpfloat (lod->max_x, ==, 0);
+
+	/* the same level is used again */
+	g_assert (egg_graph_series_get_lod (series, -100000, 0, 1000) == lod);
+
+	/* zoomed in uses the real points */
+	tmp = egg_graph_series_get_lod (series, -2000, -1000, 1000);
+	g_assert (tmp == series);
+
+	/* only the visible points are decimated */
+	g_assert (egg_graph_series_find_range (lod, -50000, -40000, &first, &end));
+	tmp = egg_graph_series_decimate_range (lod, first, end, -50000, -40000, 0.1);
+	g_assert_cmpint (tmp->len, <=, 4 * 1001);
+	g_assert_cmpfloat (tmp->min_x, >=, -50000);
+	g_assert_cmpfloat (tmp->max_x, <=, -40000);
+	egg_graph_series_unref (tmp);
+
+	/* appending throws the levels away */
+	egg_graph_series_append (series, -100000, 5, 0xff0000);
+	g_assert (series->lod == NULL);
+
+	/* and unsorted data can't be searched */
+	egg_graph_series_append (series, 5, 5, 0xff0000);
+	g_assert (!egg_graph_series_find_range (series, 0, 10, &first, &end));
+	g_assert (egg_graph_series_get_lod (series, -100000, 10, 10) == series);
+	egg_graph_series_unref (series);
+}
+
+static void
+gpm_test_graph_series_nearest_func (void)
+{
+	EggGraphSeries *series;
+	guint idx;
+
+	/* nothing to find */
+	series = egg_graph_series_new ();
+	g_assert (!egg_graph_series_find_nearest (series, 0, &idx));
+
+	/* newest first, every ten seconds */
+	egg_graph_series_append (series, 0, 10, 0xff0000);
+	egg_graph_series_append (series, -10, 20, 0xff0000);
+	egg_graph_series_append (series, -20, 30, 0x00ff00);
+	egg_graph_series_append (series, -30, 40, 0x00ff00);
+	g_assert (egg_graph_series_find_nearest (series, -12, &idx));
+	g_assert_cmpint (idx, ==, 1);
+	g_assert (egg_graph_series_find_nearest (series, -18, &idx));
+	g_assert_cmpint (idx, ==, 2);
+	g_assert (egg_graph_series_find_nearest (series, 50, &idx));
+	g_assert_cmpint (idx, ==, 0);
+	g_assert (egg_graph_series_find_nearest (series, -500, &idx));
+	g_assert_cmpint (idx, ==, 3);
+
+	/* unsorted still works, just more slowly */
+	egg_graph_series_append (series, -14, 50, 0x0000ff);
+	g_assert (egg_graph_series_find_nearest (series, -15, &idx));
+	g_assert_cmpint (idx, ==, 4);
+	egg_graph_series_unref (series);
+}
+
+/* the SVG of a week of samples, spread over @len points */
+static gchar *
+gpm_test_graph_widget_export (GtkWidget *graph, guint len)
+{
+	EggGraphSeries *series;
+	guint i;
+
+	series = egg_graph_series_sized_new (len);
+	for (i = 0; i < len; i++)
+		egg_graph_series_append (series, -(gdouble) i * 604800 / len, i % 100, 0xff0000);
+	egg_graph_widget_data_clear (EGG_GRAPH_WIDGET (graph));
+	egg_graph_widget_data_take (EGG_GRAPH_WIDGET (graph), EGG_GRAPH_WIDGET_PLOT_BOTH, series);
+	return egg_graph_widget_export_to_svg (EGG_GRAPH_WIDGET (graph), 400, 250);
+}
+
+static void
+gpm_test_graph_widget_func (void)
+{
+	GtkWidget *graph;
+	g_autofree gchar *small = NULL;
+	g_autofree gchar *large = NULL;
+
+	if (!gtk_init_check ()) {
+		g_test_skip ("no display");
+		return;
+	}
+
+	graph = g_object_ref_sink (egg_graph_widget_new ());
+	g_object_set (graph,
+		      "autorange-x", FALSE,
+		      "start-x", -604800.f,
+		      "stop-x", 0.f,
+		      "autorange-y", FALSE,
+		      "start-y", 0.f,
+		      "stop-y", 100.f,
+		      NULL);
+	g_assert (!egg_graph_widget_get_zoomed (EGG_GRAPH_WIDGET (graph)));
+
+	/* what is drawn depends on the width, not on the number of samples */
+	small = gpm_test_graph_widget_export (graph, 20000);
+	large = gpm_test_graph_widget_export (graph, 200000);
+	g_assert_cmpint (strlen (large), <, strlen (small) * 2);
+
+	/* setting the same range again does not change anything */
+	g_object_set (graph, "start-x", -604800.f, NULL);
+	g_assert (!egg_graph_widget_get_zoomed (EGG_GRAPH_WIDGET (graph)));
+	g_object_unref (graph);
+}
+
+static GPtrArray *
+gpm_test_history_new (guint from, guint to)
+{
+	GPtrArray *array;
+	UpHistoryItem *item;
+	guint i;
+
+	/* newest first, like upowerd */
+	array = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	for (i = to; i >= from; i -= 10) {
+		item = up_history_item_new ();
+		up_history_item_set_time (item, i);
+		up_history_item_set_value (item, i / 10);
+		g_ptr_array_add (array, item);
+	}
+	return array;
+}
+
+static void
+gpm_test_history_cache_func (void)
+{
+	GpmHistoryCache *cache;
+	GPtrArray *array;
+	GPtrArray *result;
+	guint newest = 0;
+
+	cache = gpm_history_cache_new ();
+	result = gpm_history_cache_lookup (cache, "/bat0", "rate", 100, 50, &newest);
+	g_assert (result == NULL);
+
+	/* store the whole range */
+	array = gpm_test_history_new (1010, 1100);
+	result = gpm_history_cache_add (cache, "/bat0", "rate", 100, 50, array, TRUE, 1100);
+	g_assert_cmpint (result->len, ==, 10);
+	g_ptr_array_unref (result);
+	g_ptr_array_unref (array);
+
+	result = gpm_history_cache_lookup (cache, "/bat0", "rate", 100, 50, &newest);
+	g_assert (result != NULL);
+	g_assert_cmpint (newest, ==, 1100);
+	g_ptr_array_unref (result);
+
+	/* a coarser resolution is served from the finer data */
+	result = gpm_history_cache_lookup (cache, "/bat0", "rate", 100, 40, NULL);
+	g_assert (result != NULL);
+	g_ptr_array_unref (result);
+
+	/* other keys and finer resolutions miss */
+	g_assert (gpm_history_cache_lookup (cache, "/bat1", "rate", 100, 50, NULL) == NULL);
+	g_assert (gpm_history_cache_lookup (cache, "/bat0", "charge", 100, 50, NULL) == NULL);
+	g_assert (gpm_history_cache_lookup (cache, "/bat0", "rate", 200, 50, NULL) == NULL);
+	g_assert (gpm_history_cache_lookup (cache, "/bat0", "rate", 100, 60, NULL) == NULL);
+
+	/* merge a tail that overlaps by one, and drop what fell out of range */
+	array = gpm_test_history_new (1100, 1130);
+	result = gpm_history_cache_add (cache, "/bat0", "rate", 100, 50, array, FALSE, 1130);
+	g_assert_cmpint (result->len, ==, 10);
+	g_assert_cmpint (up_history_item_get_time (g_ptr_array_index (result, 0)), ==, 1130);
+	g_assert_cmpint (up_history_item_get_time (g_ptr_array_index (result, 9)), ==, 1040);
+	g_ptr_array_unref (result);
+	g_ptr_array_unref (array);
+	result = gpm_history_cache_lookup (cache, "/bat0", "rate", 100, 50, &newest);
+	g_assert_cmpint (newest, ==, 1130);
+	g_ptr_array_unref (result);
+
+	/* growing well past the resolution forces a full fetch */
+	array = gpm_test_history_new (1140, 1500);
+	result = gpm_history_cache_add (cache, "/bat0", "rate", 1000, 10, array, TRUE, 1500);
+	g_assert_cmpint (result->len, ==, 37);
+	g_ptr_array_unref (result);
+	g_ptr_array_unref (array);
+	g_assert (gpm_history_cache_lookup (cache, "/bat0", "rate", 1000, 10, NULL) == NULL);
+
+	/* removed devices are forgotten */
+	gpm_history_cache_invalidate (cache, "/bat0");
+	g_assert (gpm_history_cache_lookup (cache, "/bat0", "rate", 100, 50, NULL) == NULL);
+
+	gpm_history_cache_free (cache);
+}
+
+static void
+gpm_test_stats_cache_func (void)
+{
+	GpmStatsCache *cache;
+	GPtrArray *array;
+	GPtrArray *result;
+
+	cache = gpm_stats_cache_new ();
+	g_assert (gpm_stats_cache_lookup (cache, "/bat0", "charging") == NULL);
+
+	/* one array serves both the profile and the accuracy */
+	array = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	g_ptr_array_add (array, up_stats_item_new ());
+	gpm_stats_cache_add (cache, "/bat0", "charging", array, 0);
+	g_ptr_array_unref (array);
+	result = gpm_stats_cache_lookup (cache, "/bat0", "charging");
+	g_assert (result != NULL);
+	g_assert_cmpint (result->len, ==, 1);
+	g_ptr_array_unref (result);
+
+	/* other devices and directions miss */
+	g_assert (gpm_stats_cache_lookup (cache, "/bat1", "charging") == NULL);
+	g_assert (gpm_stats_cache_lookup (cache, "/bat0", "discharging") == NULL);
+
+	/* an empty profile is still worth remembering */
+	array = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	gpm_stats_cache_add (cache, "/bat0", "discharging", array, 0);
+	g_ptr_array_unref (array);
+	result = gpm_stats_cache_lookup (cache, "/bat0", "discharging");
+	g_assert (result != NULL);
+	g_assert_cmpint (result->len, ==, 0);
+	g_ptr_array_unref (result);
+
+	/* a change of state forgets both directions */
+	gpm_stats_cache_invalidate (cache, "/bat0");
+	g_assert (gpm_stats_cache_lookup (cache, "/bat0", "charging") == NULL);
+	g_assert (gpm_stats_cache_lookup (cache, "/bat0", "discharging") == NULL);
+
+	/* a reply to a request made before that is not stored */
+	array = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	g_assert (!gpm_stats_cache_add (cache, "/bat0", "charging", array, 0));
+	g_assert (gpm_stats_cache_lookup (cache, "/bat0", "charging") == NULL);
+	g_assert (gpm_stats_cache_add (cache, "/bat0", "charging", array,
+				       gpm_stats_cache_get_generation (cache, "/bat0")));
+	g_ptr_array_unref (array);
+	result = gpm_stats_cache_lookup (cache, "/bat0", "charging");
+	g_assert (result != NULL);
+	g_ptr_array_unref (result);
+
+	gpm_stats_cache_free (cache);
+}
+
 int
 main (int argc, char **argv)
 {
@@ -306,6 +852,15 @@ main (int argc, char **argv)
 
 	/* tests go here */
 	g_test_add_func ("/power/array_float", gpm_test_array_float_func);
+	g_test_add_func ("/power/array_float_outliers", gpm_test_array_float_outliers_func);
+	g_test_add_func ("/power/array_float_convolve", gpm_test_array_float_convolve_func);
+	g_test_add_func ("/power/graph_series", gpm_test_graph_series_func);
+	g_test_add_func ("/power/graph_series_decimate", gpm_test_graph_series_decimate_func);
+	g_test_add_func ("/power/graph_series_lod", gpm_test_graph_series_lod_func);
+	g_test_add_func ("/power/graph_series_nearest", gpm_test_graph_series_nearest_func);
+	g_test_add_func ("/power/graph_widget", gpm_test_graph_widget_func);
+	g_test_add_func ("/power/history_cache", gpm_test_history_cache_func);
+	g_test_add_func ("/power/stats_cache", gpm_test_stats_cache_func);
 
 	return g_test_run ();
 }
@@ -21,14 +21,19 @@
 
 #include "config.h"
 
+#include <errno.h>
 #include <locale.h>
+#include <stdlib.h>
 #include <glib.h>
 #include <glib/gi18n.h>
 #include <gtk/gtk.h>
 #include <libupower-glib/upower.h>
 
 #include "gpm-array-float.h"
+#include "gpm-history-cache.h"
+#include "gpm-stats-cache.h"
 #include "gpm-rotated-widget.h"
+#include "gpm-upower.h"
 #include "egg-graph-widget.h"
 
 #define GPM_SETTINGS_SCHEMA				"org.gnome.power-manager"
@@ -41,6 +46,7 @@
 #define GPM_SETTINGS_INFO_STATS_GRAPH_POINTS		"info-stats-graph-points"
 #define GPM_SETTINGS_INFO_PAGE_NUMBER			"info-page-number"
 #define GPM_SETTINGS_INFO_LAST_DEVICE			"info-last-device"
+#define GPM_SETTINGS_INFO_REFRESH_INTERVAL		"info-refresh-interval"
 
 static GtkBuilder *builder = NULL;
 static GtkListStore *list_store_info = NULL;
@@ -56,6 +62,31 @@ static GtkWidget *graph_history = NULL;
 static GtkWidget *graph_statistics = NULL;
 static UpClient *client = NULL;
 static GPtrArray *devices = NULL;
+static GHashTable *devices_by_path = NULL;
+static GCancellable *history_cancellable = NULL;
+static GCancellable *stats_cancellable = NULL;
+static GpmHistoryCache *history_cache = NULL;
+static GpmStatsCache *stats_cache = NULL;
+static gint64 history_now = 0;
+static gint history_width = 0;
+static guint history_resolution = 0;
+static UpDevice *refresh_device = NULL;
+static guint refresh_id = 0;
+static guint refresh_coalesced = 0;
+static guint refresh_skipped = 0;
+static guint refresh_paused = 0;
+static gboolean fetch_pending = FALSE;
+static GCancellable *prefetch_cancellable = NULL;
+static guint prefetch_id = 0;
+static gboolean prefetch_deferred = FALSE;
+static gchar *startup_device = NULL;
+static gint64 startup_time = 0;
+static gboolean startup_timing = FALSE;
+static gboolean startup_graph_shown = FALSE;
+static EggGraphSeries *history_raw = NULL;
+static EggGraphSeries *history_smoothed = NULL;
+static EggGraphSeries *stats_raw = NULL;
+static EggGraphSeries *stats_smoothed = NULL;
 
 enum {
 	GPM_INFO_COLUMN_TEXT,
@@ -98,6 +129,12 @@ enum {
 #define GPM_HISTORY_DAY_DIVS			12 /* 2 hr tick */
 #define GPM_HISTORY_WEEK_DIVS			7  /* 1 day tick */
 
+#define GPM_HISTORY_RESOLUTION_DEFAULT		150 /* before the graph has a size */
+#define GPM_HISTORY_RESOLUTION_MIN		50
+#define GPM_HISTORY_PIXELS_PER_POINT		2
+#define GPM_HISTORY_SAMPLE_INTERVAL		30  /* upowerd never stores more often */
+#define GPM_HISTORY_RESOLUTION_THRESHOLD	4   /* re-query on a 1/4 change */
+
 /* TRANSLATORS: what we've observed about the device */
 #define GPM_STATS_CHARGE_DATA_TEXT		_("Charge profile")
 #define GPM_STATS_DISCHARGE_DATA_TEXT		_("Discharge profile")
@@ -110,9 +147,41 @@ enum {
 #define GPM_STATS_DISCHARGE_DATA_VALUE		"discharge-data"
 #define GPM_STATS_DISCHARGE_ACCURACY_VALUE	"discharge-accuracy"
 
+#define GPM_STATS_RENDER_WIDTH			800
+#define GPM_STATS_RENDER_HEIGHT			500
+
 #define GPM_UP_TIME_PRECISION			5*60 /* seconds */
 #define GPM_UP_TEXT_MIN_TIME			120 /* seconds */
 
+/* the proxy UpClient already keeps up to date, without any D-Bus traffic */
+static UpDevice *
+gpm_stats_get_device (const gchar *object_path)
+{
+	if (object_path == NULL || devices_by_path == NULL)
+		return NULL;
+	return g_hash_table_lookup (devices_by_path, object_path);
+}
+
+/* prints how long startup took to get to something, for --timing */
+static void
+gpm_stats_timing_report (const gchar *what)
+{
+	if (!startup_timing)
+		return;
+	g_print ("%s: %.1f ms\n", what,
+		 (g_get_monotonic_time () - startup_time) / 1000.f);
+}
+
+/* called whenever a graph has been filled in, but only the first counts */
+static void
+gpm_stats_timing_graph_shown (void)
+{
+	if (startup_graph_shown)
+		return;
+	startup_graph_shown = TRUE;
+	gpm_stats_timing_report ("Time to first graph");
+}
+
 /**
  * gpm_stats_get_device_icon_suffix:
  * @device: The UpDevice
@@ -417,41 +486,34 @@ gpm_stats_add_info_data (const gchar *attr, const gchar *text)
 			    GPM_INFO_COLUMN_VALUE, text, -1);
 }
 
-static GPtrArray *
-gpm_stats_update_smooth_data (GPtrArray *list)
+static EggGraphSeries *
+gpm_stats_update_smooth_data (EggGraphSeries *series)
 {
 	guint i;
-	EggGraphPoint *point;
-	EggGraphPoint *point_new;
-	GPtrArray *new;
+	EggGraphSeries *new;
 	GpmArrayFloat *raw;
 	GpmArrayFloat *convolved;
 	GpmArrayFloat *outliers;
 	GpmArrayFloat *gaussian = NULL;
 
 	/* convert the y data to a GpmArrayFloat array */
-	raw = gpm_array_float_new (list->len);
-	for (i = 0; i < list->len; i++) {
-		point = (EggGraphPoint *) g_ptr_array_index (list, i);
-		gpm_array_float_set (raw, i, point->y);
-	}
+	raw = gpm_array_float_new (series->len);
+	for (i = 0; i < series->len; i++)
+		gpm_array_float_set (raw, i, series->y[i]);
 
 	/* remove any outliers */
 	outliers = gpm_array_float_remove_outliers (raw, 3, 0.1);
 
 	/* convolve with gaussian */
-	gaussian = gpm_array_float_compute_gaussian (15, sigma_smoothing);
+	gaussian = gpm_array_float_get_gaussian (15, sigma_smoothing);
 	convolved = gpm_array_float_convolve (outliers, gaussian);
 
-	/* add the smoothed data back into a new array */
-	new = g_ptr_array_new_with_free_func ((GDestroyNotify) egg_graph_point_free);
-	for (i = 0; i < list->len; i++) {
-		point = (EggGraphPoint *) g_ptr_array_index (list, i);
-		point_new = g_new0 (EggGraphPoint, 1);
-		point_new->color = point->color;
-		point_new->x = point->x;
-		point_new->y = gpm_array_float_get (convolved, i);
-		g_ptr_array_add (new, point_new);
+	/* add the smoothed data back into a new series */
+	new = egg_graph_series_sized_new (series->len);
+	for (i = 0; i < series->len; i++) {
+		egg_graph_series_append (new, series->x[i],
+					 gpm_array_float_get (convolved, i),
+					 series->color[i]);
 	}
 
 	/* free data */
@@ -683,24 +745,22 @@ gpm_stats_update_info_page_details (UpDevice *device)
 }
 
 static void
-gpm_stats_set_graph_data (GtkWidget *widget, GPtrArray *data, gboolean use_smoothed, gboolean use_points)
+gpm_stats_set_graph_data (GtkWidget *widget, EggGraphSeries *data, EggGraphSeries *smoothed, gboolean use_points)
 {
-	GPtrArray *smoothed;
+	EggGraphWidget *graph = EGG_GRAPH_WIDGET (widget);
 
-	egg_graph_widget_data_clear (EGG_GRAPH_WIDGET (widget));
+	egg_graph_widget_data_clear (graph);
 
-	/* add correct data */
-	if (!use_smoothed) {
+	/* add correct data, which the graph shares rather than copies */
+	if (smoothed == NULL) {
 		if (use_points)
-			egg_graph_widget_data_add (EGG_GRAPH_WIDGET (widget), EGG_GRAPH_WIDGET_PLOT_BOTH, data);
+			egg_graph_widget_data_take (graph, EGG_GRAPH_WIDGET_PLOT_BOTH, egg_graph_series_ref (data));
 		else
-			egg_graph_widget_data_add (EGG_GRAPH_WIDGET (widget), EGG_GRAPH_WIDGET_PLOT_LINE, data);
+			egg_graph_widget_data_take (graph, EGG_GRAPH_WIDGET_PLOT_LINE, egg_graph_series_ref (data));
 	} else {
-		smoothed = gpm_stats_update_smooth_data (data);
 		if (use_points)
-			egg_graph_widget_data_add (EGG_GRAPH_WIDGET (widget), EGG_GRAPH_WIDGET_PLOT_POINTS, data);
-		egg_graph_widget_data_add (EGG_GRAPH_WIDGET (widget), EGG_GRAPH_WIDGET_PLOT_LINE, smoothed);
-		g_ptr_array_unref (smoothed);
+			egg_graph_widget_data_take (graph, EGG_GRAPH_WIDGET_PLOT_POINTS, egg_graph_series_ref (data));
+		egg_graph_widget_data_take (graph, EGG_GRAPH_WIDGET_PLOT_LINE, egg_graph_series_ref (smoothed));
 	}
 
 	/* show */
@@ -717,70 +777,75 @@ gpm_color_from_rgb (guint8 red, guint8 green, guint8 blue)
 	return color;
 }
 
+/* cancels any request still in flight, and returns a fresh cancellable */
+static GCancellable *
+gpm_stats_restart_cancellable (GCancellable **cancellable)
+{
+	if (*cancellable != NULL) {
+		g_cancellable_cancel (*cancellable);
+		g_object_unref (*cancellable);
+	}
+	*cancellable = g_cancellable_new ();
+	return *cancellable;
+}
+
 static void
-gpm_stats_update_info_page_history (UpDevice *device)
+gpm_stats_cancel_fetches (void)
 {
-	GPtrArray *array;
-	guint i;
-	UpHistoryItem *item;
-	GtkWidget *widget;
-	gboolean checked;
-	gboolean points;
-	EggGraphPoint *point;
-	GPtrArray *new;
-	gint64 offset = 0;
+	if (history_cancellable != NULL)
+		g_cancellable_cancel (history_cancellable);
+	if (stats_cancellable != NULL)
+		g_cancellable_cancel (stats_cancellable);
+}
 
-	new = g_ptr_array_new_with_free_func ((GDestroyNotify) egg_graph_point_free);
-	if (g_strcmp0 (history_type, GPM_HISTORY_CHARGE_VALUE) == 0) {
-		g_object_set (graph_history,
+static void
+gpm_stats_set_history_axes (GtkWidget *graph, const gchar *type, guint timespan, guint divs)
+{
+	if (g_strcmp0 (type, GPM_HISTORY_CHARGE_VALUE) == 0) {
+		g_object_set (graph,
 			      "type-x", EGG_GRAPH_WIDGET_KIND_TIME,
 			      "type-y", EGG_GRAPH_WIDGET_KIND_PERCENTAGE,
 			      "autorange-x", FALSE,
-			      "divs-x", (guint) divs_x,
-			      "start-x", -(gdouble) history_time,
+			      "divs-x", divs,
+			      "start-x", -(gdouble) timespan,
 			      "stop-x", (gdouble) 0.f,
 			      "autorange-y", FALSE,
 			      "start-y", (gdouble) 0.f,
 			      "stop-y", (gdouble) 100.f,
 			      NULL);
-	} else if (g_strcmp0 (history_type, GPM_HISTORY_RATE_VALUE) == 0) {
-		g_object_set (graph_history,
+	} else if (g_strcmp0 (type, GPM_HISTORY_RATE_VALUE) == 0) {
+		g_object_set (graph,
 			      "type-x", EGG_GRAPH_WIDGET_KIND_TIME,
 			      "type-y", EGG_GRAPH_WIDGET_KIND_POWER,
 			      "autorange-x", FALSE,
-			      "divs-x", (guint) divs_x,
-			      "start-x", -(gdouble) history_time,
+			      "divs-x", divs,
+			      "start-x", -(gdouble) timespan,
 			      "stop-x", (gdouble) 0.f,
 			      "autorange-y", TRUE,
 			      NULL);
 	} else {
-		g_object_set (graph_history,
+		g_object_set (graph,
 			      "type-x", EGG_GRAPH_WIDGET_KIND_TIME,
 			      "type-y", EGG_GRAPH_WIDGET_KIND_TIME,
 			      "autorange-x", FALSE,
-			      "divs-x", (guint) divs_x,
-			      "start-x", -(gdouble) history_time,
+			      "divs-x", divs,
+			      "start-x", -(gdouble) timespan,
 			      "stop-x", (gdouble) 0.f,
 			      "autorange-y", TRUE,
 			      NULL);
 	}
+}
 
-	widget = GTK_WIDGET (gtk_builder_get_object (builder, "label_history_nodata"));
-	array = up_device_get_history_sync (device, history_type, history_time, 150, NULL, NULL);
-	if (array == NULL) {
-		/* show no data label and hide graph */
-		gtk_widget_hide (graph_history);
-		gtk_widget_show (widget);
-		goto out;
-	}
-
-	/* hide no data and show graph */
-	gtk_widget_hide (widget);
-	gtk_widget_show (graph_history);
-
-	/* convert microseconds to seconds */
-	offset = g_get_real_time() / 1000000;
+/* converts UpHistoryItems to a series with X in seconds before now */
+static EggGraphSeries *
+gpm_stats_history_to_series (GPtrArray *array, const gchar *type, gint64 now)
+{
+	guint i;
+	UpHistoryItem *item;
+	guint32 color;
+	EggGraphSeries *new;
 
+	new = egg_graph_series_sized_new (array->len);
 	for (i = 0; i < array->len; i++) {
 		item = (UpHistoryItem *) g_ptr_array_index (array, i);
 
@@ -788,275 +853,946 @@ gpm_stats_update_info_page_history (UpDevice *device)
 		if (up_history_item_get_state (item) == UP_DEVICE_STATE_UNKNOWN)
 			continue;
 
-		point = egg_graph_point_new ();
-		point->x = (gint) up_history_item_get_time (item) - offset;
-		point->y = up_history_item_get_value (item);
 		if (up_history_item_get_state (item) == UP_DEVICE_STATE_CHARGING)
-			point->color = gpm_color_from_rgb (255, 0, 0);
+			color = gpm_color_from_rgb (255, 0, 0);
 		else if (up_history_item_get_state (item) == UP_DEVICE_STATE_DISCHARGING)
-			point->color = gpm_color_from_rgb (0, 0, 255);
+			color = gpm_color_from_rgb (0, 0, 255);
 		else if (up_history_item_get_state (item) == UP_DEVICE_STATE_PENDING_CHARGE)
-			point->color = gpm_color_from_rgb (200, 0, 0);
+			color = gpm_color_from_rgb (200, 0, 0);
 		else if (up_history_item_get_state (item) == UP_DEVICE_STATE_PENDING_DISCHARGE)
-			point->color = gpm_color_from_rgb (0, 0, 200);
+			color = gpm_color_from_rgb (0, 0, 200);
 		else {
-			if (g_strcmp0 (history_type, GPM_HISTORY_RATE_VALUE) == 0)
-				point->color = gpm_color_from_rgb (255, 255, 255);
+			if (g_strcmp0 (type, GPM_HISTORY_RATE_VALUE) == 0)
+				color = gpm_color_from_rgb (255, 255, 255);
 			else
-				point->color = gpm_color_from_rgb (0, 255, 0);
+				color = gpm_color_from_rgb (0, 255, 0);
 		}
-		g_ptr_array_add (new, point);
+		egg_graph_series_append (new,
+					 (gint) up_history_item_get_time (item) - now,
+					 up_history_item_get_value (item),
+					 color);
 	}
+	return new;
+}
+
+/* redraws the last fetched history, e.g. when only the smoothing changed */
+static void
+gpm_stats_present_history (void)
+{
+	GtkWidget *widget;
+	gboolean checked;
+	gboolean points;
+
+	if (history_raw == NULL)
+		return;
 
-	/* render */
-	sigma_smoothing = 2.0;
 	widget = GTK_WIDGET (gtk_builder_get_object (builder, "checkbutton_smooth_history"));
 	checked = gtk_check_button_get_active (GTK_CHECK_BUTTON (widget));
 	widget = GTK_WIDGET (gtk_builder_get_object (builder, "checkbutton_points_history"));
 	points = gtk_check_button_get_active (GTK_CHECK_BUTTON (widget));
 
-	/* present data to graph */
-	gpm_stats_set_graph_data (graph_history, new, checked, points);
+	/* smoothing is the slow part, so it is only done once per fetch */
+	if (checked && history_smoothed == NULL) {
+		sigma_smoothing = 2.0;
+		history_smoothed = gpm_stats_update_smooth_data (history_raw);
+	}
 
-	g_ptr_array_unref (array);
-	g_ptr_array_unref (new);
-out:
-	return;
+	/* present data to graph */
+	gpm_stats_set_graph_data (graph_history, history_raw,
+				  checked ? history_smoothed : NULL, points);
 }
 
 static void
-gpm_stats_update_info_page_stats (UpDevice *device)
+gpm_stats_render_history (GPtrArray *array)
 {
-	GPtrArray *array;
-	guint i;
-	UpStatsItem *item;
 	GtkWidget *widget;
-	gboolean checked;
-	gboolean points;
-	EggGraphPoint *point;
-	GPtrArray *new;
-	gboolean use_data = FALSE;
-	const gchar *type = NULL;
-
-	new = g_ptr_array_new_with_free_func ((GDestroyNotify) egg_graph_point_free);
-	if (g_strcmp0 (stats_type, GPM_STATS_CHARGE_DATA_VALUE) == 0) {
-		type = "charging";
-		use_data = TRUE;
-	} else if (g_strcmp0 (stats_type, GPM_STATS_DISCHARGE_DATA_VALUE) == 0) {
-		type = "discharging";
-		use_data = TRUE;
-	} else if (g_strcmp0 (stats_type, GPM_STATS_CHARGE_ACCURACY_VALUE) == 0) {
-		type = "charging";
-		use_data = FALSE;
-	} else if (g_strcmp0 (stats_type, GPM_STATS_DISCHARGE_ACCURACY_VALUE) == 0) {
-		type = "discharging";
-		use_data = FALSE;
-	} else {
-		g_assert_not_reached ();
-	}
+	gint64 offset = 0;
 
-	if (use_data) {
-		g_object_set (graph_statistics,
-			      "type-x", EGG_GRAPH_WIDGET_KIND_PERCENTAGE,
-			      "type-y", EGG_GRAPH_WIDGET_KIND_FACTOR,
-			      "divs-x", 10,
-			      "autorange-x", TRUE,
-			      "autorange-y", TRUE,
-			      NULL);
-	} else {
-		g_object_set (graph_statistics,
-			      "type-x", EGG_GRAPH_WIDGET_KIND_PERCENTAGE,
-			      "type-y", EGG_GRAPH_WIDGET_KIND_PERCENTAGE,
-			      "divs-x", 10,
-			      "autorange-x", TRUE,
-			      "autorange-y", TRUE,
-			      NULL);
-	}
+	gpm_stats_set_history_axes (graph_history, history_type, history_time, divs_x);
+	g_clear_pointer (&history_raw, egg_graph_series_unref);
+	g_clear_pointer (&history_smoothed, egg_graph_series_unref);
 
-	widget = GTK_WIDGET (gtk_builder_get_object (builder, "label_stats_nodata"));
-	array = up_device_get_statistics_sync (device, type, NULL, NULL);
-	if (array == NULL) {
+	gpm_stats_timing_graph_shown ();
+	widget = GTK_WIDGET (gtk_builder_get_object (builder, "label_history_nodata"));
+	if (array == NULL || array->len == 0) {
 		/* show no data label and hide graph */
-		gtk_widget_hide (graph_statistics);
+		gtk_widget_hide (graph_history);
 		gtk_widget_show (widget);
-		goto out;
+		return;
 	}
 
 	/* hide no data and show graph */
 	gtk_widget_hide (widget);
-	gtk_widget_show (graph_statistics);
+	gtk_widget_show (graph_history);
 
-	for (i = 0; i < array->len; i++) {
-		item = (UpStatsItem *) g_ptr_array_index (array, i);
-		point = egg_graph_point_new ();
-		point->x = i;
-		if (use_data)
-			point->y = up_stats_item_get_value (item);
-		else
-			point->y = up_stats_item_get_accuracy (item);
-		point->color = gpm_color_from_rgb (255, 0, 0);
-		g_ptr_array_add (new, point);
-	}
+	/* convert microseconds to seconds */
+	offset = g_get_real_time() / 1000000;
 
-	/* render */
-	sigma_smoothing = 1.1;
-	widget = GTK_WIDGET (gtk_builder_get_object (builder, "checkbutton_smooth_stats"));
-	checked = gtk_check_button_get_active (GTK_CHECK_BUTTON (widget));
-	widget = GTK_WIDGET (gtk_builder_get_object (builder, "checkbutton_points_stats"));
-	points = gtk_check_button_get_active (GTK_CHECK_BUTTON (widget));
+	/* the X values are relative to now, so keep a zoom on the same times */
+	if (history_now != 0)
+		egg_graph_widget_zoom_shift (EGG_GRAPH_WIDGET (graph_history), history_now - offset);
+	history_now = offset;
+	history_raw = gpm_stats_history_to_series (array, history_type, offset);
+	gpm_stats_present_history ();
+}
 
-	/* present data to graph */
-	gpm_stats_set_graph_data (graph_statistics, new, checked, points);
+typedef struct {
+	gchar		*object_path;
+	gchar		*type;
+	guint		 timespan;
+	guint		 resolution;
+	gboolean	 tail;
+} GpmStatsHistoryRequest;
 
-	g_ptr_array_unref (array);
-	g_ptr_array_unref (new);
-out:
-	return;
+static void
+gpm_stats_history_request_free (GpmStatsHistoryRequest *request)
+{
+	g_free (request->object_path);
+	g_free (request->type);
+	g_free (request);
 }
 
+typedef struct {
+	gchar		*object_path;
+	gchar		*type;
+	guint		 generation;
+} GpmStatsStatsRequest;
+
 static void
-gpm_stats_update_info_data_page (UpDevice *device, gint page)
+gpm_stats_stats_request_free (GpmStatsStatsRequest *request)
 {
-	if (page == 0)
-		gpm_stats_update_info_page_details (device);
-	else if (page == 1)
-		gpm_stats_update_info_page_history (device);
-	else if (page == 2)
-		gpm_stats_update_info_page_stats (device);
+	g_free (request->object_path);
+	g_free (request->type);
+	g_free (request);
 }
 
-static void
-gpm_stats_update_info_data (UpDevice *device)
+/* the number of points worth asking for at the current width and range */
+static guint
+gpm_stats_get_history_resolution (void)
 {
-	gint page;
-	GtkNotebook *notebook;
-	GtkWidget *page_widget;
-	gboolean has_history;
-	gboolean has_statistics;
+	GtkWidget *widget;
+	guint resolution;
+	gint width = history_width;
+
+	/* every stored sample, so the graph can zoom without fetching again */
+	if (graph_history != NULL &&
+	    egg_graph_widget_get_zoomed (EGG_GRAPH_WIDGET (graph_history)))
+		return MAX (history_time / GPM_HISTORY_SAMPLE_INTERVAL, GPM_HISTORY_RESOLUTION_MIN);
+
+	/* the graph is only sized once its page is shown, so until then use
+	 * the notebook, which is always at least as wide as the graph */
+	if (width <= 0) {
+		widget = GTK_WIDGET (gtk_builder_get_object (builder, "notebook1"));
+		width = gtk_widget_get_width (widget);
+	}
+	if (width <= 0)
+		return GPM_HISTORY_RESOLUTION_DEFAULT;
 
-	/* get properties */
-	g_object_get (device,
-		      "has-history", &has_history,
-		      "has-statistics", &has_statistics,
-		      NULL);
+	/* nothing is gained by more points than pixels, or than are stored */
+	resolution = width / GPM_HISTORY_PIXELS_PER_POINT;
+	resolution = MIN (resolution, history_time / GPM_HISTORY_SAMPLE_INTERVAL);
+	return MAX (resolution, GPM_HISTORY_RESOLUTION_MIN);
+}
 
-	notebook = GTK_NOTEBOOK (gtk_builder_get_object (builder, "notebook1"));
+/* fetches that are only worth doing while someone is looking at the window */
+static gboolean
+gpm_stats_is_paused (void)
+{
+	GtkWidget *widget;
 
-	/* show info page */
-	page_widget = gtk_notebook_get_nth_page (notebook, 0);
-	gtk_widget_show (page_widget);
+	widget = GTK_WIDGET (gtk_builder_get_object (builder, "dialog_stats"));
+	if (!gtk_widget_get_mapped (widget))
+		return TRUE;
+	return !gtk_window_is_active (GTK_WINDOW (widget));
+}
 
-	/* hide history if no support */
-	page_widget = gtk_notebook_get_nth_page (notebook, 1);
-	if (has_history)
-		gtk_widget_show (page_widget);
-	else
-		gtk_widget_hide (page_widget);
+static void
+gpm_stats_prefetch_history_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	GpmStatsHistoryRequest *request = (GpmStatsHistoryRequest *) user_data;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) array = NULL;
+	g_autoptr(GPtrArray) merged = NULL;
 
-	/* hide statistics if no support */
-	page_widget = gtk_notebook_get_nth_page (notebook, 2);
-	if (has_statistics)
-		gtk_widget_show (page_widget);
-	else
-		gtk_widget_hide (page_widget);
+	array = gpm_upower_get_history_finish (res, &error);
+	if (array == NULL) {
+		if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			g_debug ("failed to prefetch history: %s", error->message);
+		goto out;
+	}
 
-	page = gtk_notebook_get_current_page (notebook);
-	gpm_stats_update_info_data_page (device, page);
+	/* the device went away while this was in flight */
+	if (gpm_stats_get_device (request->object_path) == NULL)
+		goto out;
 
-	return;
+	/* only cached, the history page shows it when switched to */
+	merged = gpm_history_cache_add (history_cache,
+					request->object_path,
+					request->type,
+					request->timespan,
+					request->resolution,
+					array, TRUE,
+					g_get_real_time () / G_USEC_PER_SEC);
+	g_debug ("prefetched %u points of history", merged->len);
+out:
+	gpm_stats_history_request_free (request);
 }
 
 static void
-gpm_stats_set_title (GtkWindow *window, gint page_num)
+gpm_stats_prefetch_history (UpDevice *device, GCancellable *cancellable)
 {
-	g_autofree gchar *title = NULL;
-	const gchar * const page_titles[] = {
-		/* TRANSLATORS: shown on the titlebar */
-		N_("Device Information"),
-		/* TRANSLATORS: shown on the titlebar */
-		N_("Device History"),
-		/* TRANSLATORS: shown on the titlebar */
-		N_("Device Profile"),
-	};
+	GpmStatsHistoryRequest *request;
+	g_autoptr(GPtrArray) cached = NULL;
+	gboolean has_history;
 
-	/* TRANSLATORS: shown on the titlebar */
-	title = g_strdup_printf ("%s - %s", _("Power Statistics"), _(page_titles[page_num]));
-	gtk_window_set_title (window, title);
+	g_object_get (device, "has-history", &has_history, NULL);
+	if (!has_history)
+		return;
+
+	/* use the same key the history page will look up */
+	request = g_new0 (GpmStatsHistoryRequest, 1);
+	request->object_path = g_strdup (up_device_get_object_path (device));
+	request->type = g_strdup (history_type);
+	request->timespan = history_time;
+	request->resolution = gpm_stats_get_history_resolution ();
+	cached = gpm_history_cache_lookup (history_cache,
+					   request->object_path,
+					   request->type,
+					   request->timespan,
+					   request->resolution,
+					   NULL);
+	if (cached != NULL) {
+		g_debug ("history already cached, nothing to prefetch");
+		gpm_stats_history_request_free (request);
+		return;
+	}
+
+	g_debug ("prefetching %u points over %us of history",
+		 request->resolution, request->timespan);
+	gpm_upower_get_history_async (request->object_path,
+				      request->type,
+				      request->timespan,
+				      request->resolution,
+				      cancellable,
+				      gpm_stats_prefetch_history_cb, request);
 }
 
 static void
-gpm_stats_notebook_changed_cb (GtkNotebook *notebook, gpointer page, gint page_num, gpointer user_data)
+gpm_stats_prefetch_stats_cb (GObject *source, GAsyncResult *res, gpointer user_data)
 {
-	UpDevice *device;
-	GtkWidget *widget;
+	GpmStatsStatsRequest *request = (GpmStatsStatsRequest *) user_data;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) array = NULL;
 
-	/* set the window title depending on the mode */
-	widget = GTK_WIDGET (gtk_builder_get_object (builder, "dialog_stats"));
-	gpm_stats_set_title (GTK_WINDOW (widget), page_num);
+	array = gpm_upower_get_statistics_finish (res, &error);
+	if (array == NULL) {
+		if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			g_debug ("failed to prefetch statistics: %s", error->message);
+		goto out;
+	}
+	if (gpm_stats_get_device (request->object_path) == NULL)
+		goto out;
+	if (!gpm_stats_cache_add (stats_cache, request->object_path,
+				  request->type, array, request->generation)) {
+		g_debug ("prefetched %s statistics are out of date", request->type);
+		goto out;
+	}
+	g_debug ("prefetched %u %s statistics", array->len, request->type);
+out:
+	gpm_stats_stats_request_free (request);
+}
 
-	/* save page in gconf */
-	g_settings_set_int (settings, GPM_SETTINGS_INFO_PAGE_NUMBER, page_num);
+static void
+gpm_stats_prefetch_stats (UpDevice *device, GCancellable *cancellable)
+{
+	const gchar *types[] = { "charging", "discharging", NULL };
+	GpmStatsStatsRequest *request;
+	gboolean has_statistics;
+	guint i;
 
-	if (current_device == NULL)
+	g_object_get (device, "has-statistics", &has_statistics, NULL);
+	if (!has_statistics)
 		return;
 
-	device = up_device_new ();
-	up_device_set_object_path_sync (device, current_device, NULL, NULL);
-	gpm_stats_update_info_data_page (device, page_num);
-	g_object_unref (device);
-}
+	/* each direction covers two of the four graphs */
+	for (i = 0; types[i] != NULL; i++) {
+		g_autoptr(GPtrArray) cached = NULL;
 
-static void
-gpm_stats_button_update_ui (void)
-{
-	UpDevice *device;
-	device = up_device_new ();
-	up_device_set_object_path_sync (device, current_device, NULL, NULL);
-	gpm_stats_update_info_data (device);
-	g_object_unref (device);
+		cached = gpm_stats_cache_lookup (stats_cache,
+						 up_device_get_object_path (device),
+						 types[i]);
+		if (cached != NULL) {
+			g_debug ("%s statistics already cached, nothing to prefetch", types[i]);
+			continue;
+		}
+		g_debug ("prefetching %s statistics", types[i]);
+		request = g_new0 (GpmStatsStatsRequest, 1);
+		request->object_path = g_strdup (up_device_get_object_path (device));
+		request->type = g_strdup (types[i]);
+		request->generation = gpm_stats_cache_get_generation (stats_cache,
+								      request->object_path);
+		gpm_upower_get_statistics_async (request->object_path, request->type,
+						 cancellable,
+						 gpm_stats_prefetch_stats_cb, request);
+	}
 }
 
-static void
-gpm_stats_devices_treeview_clicked_cb (GtkTreeSelection *selection, gpointer user_data)
+static gboolean
+gpm_stats_prefetch_cb (gpointer user_data)
 {
-	GtkTreeModel *model;
-	GtkTreeIter iter;
+	GCancellable *cancellable;
+	GtkNotebook *notebook;
 	UpDevice *device;
 
-	/* This will only work in single or browse selection mode! */
-	if (gtk_tree_selection_get_selected (selection, &model, &iter)) {
-		g_free (current_device);
-		gtk_tree_model_get (model, &iter, GPM_DEVICES_COLUMN_ID, &current_device, -1);
+	prefetch_id = 0;
 
-		/* save device in gconf */
-		g_settings_set_string (settings, GPM_SETTINGS_INFO_LAST_DEVICE, current_device);
+	/* the visible page goes first, and schedules this again when done */
+	if (fetch_pending)
+		return G_SOURCE_REMOVE;
 
-		/* show transaction_id */
-		g_debug ("selected row is: %s", current_device);
+	/* nobody is looking, so try again when the window is next active */
+	if (gpm_stats_is_paused ()) {
+		g_debug ("window inactive, deferring prefetch");
+		prefetch_deferred = TRUE;
+		return G_SOURCE_REMOVE;
+	}
 
-		/* is special device */
-		if (1) {
-			device = up_device_new ();
-			up_device_set_object_path_sync (device, current_device, NULL, NULL);
-			gpm_stats_update_info_data (device);
-			g_object_unref (device);
-		}
+	device = gpm_stats_get_device (current_device);
+	if (device == NULL)
+		return G_SOURCE_REMOVE;
 
-	} else {
-		g_debug ("no row selected");
-	}
+	/* anything still prefetching is for an older selection */
+	cancellable = gpm_stats_restart_cancellable (&prefetch_cancellable);
+	notebook = GTK_NOTEBOOK (gtk_builder_get_object (builder, "notebook1"));
+	if (gtk_notebook_get_current_page (notebook) != 1)
+		gpm_stats_prefetch_history (device, cancellable);
+	gpm_stats_prefetch_stats (device, cancellable);
+	return G_SOURCE_REMOVE;
 }
 
+/* warms the pages that are not visible once the visible one is done */
 static void
-gpm_stats_device_changed_cb (UpDevice *device, GParamSpec *pspec, gpointer user_data)
+gpm_stats_prefetch_schedule (void)
 {
-	const gchar *object_path;
-	object_path = up_device_get_object_path (device);
-	if (object_path == NULL || current_device == NULL)
+	if (prefetch_id != 0)
 		return;
-	g_debug ("changed:   %s", object_path);
-	if (g_strcmp0 (current_device, object_path) == 0)
-		gpm_stats_update_info_data (device);
+	prefetch_id = g_idle_add_full (G_PRIORITY_LOW, gpm_stats_prefetch_cb, NULL, NULL);
+	g_source_set_name_by_id (prefetch_id, "[gpm-statistics] prefetch");
+}
+
+static void
+gpm_stats_history_ready_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	GpmStatsHistoryRequest *request = (GpmStatsHistoryRequest *) user_data;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) array = NULL;
+	g_autoptr(GPtrArray) merged = NULL;
+
+	array = gpm_upower_get_history_finish (res, &error);
+	if (array == NULL) {
+		/* the user has moved on, so this is no longer wanted */
+		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			goto out;
+		g_debug ("failed to get history: %s", error->message);
+		fetch_pending = FALSE;
+		gpm_stats_prefetch_schedule ();
+
+		/* the cached copy is already showing */
+		if (!request->tail)
+			gpm_stats_render_history (NULL);
+		goto out;
+	}
+
+	fetch_pending = FALSE;
+	gpm_stats_prefetch_schedule ();
+
+	/* nothing new since the cached copy was shown */
+	if (request->tail && array->len == 0)
+		goto out;
+
+	merged = gpm_history_cache_add (history_cache,
+					request->object_path,
+					request->type,
+					request->timespan,
+					request->resolution,
+					array, !request->tail,
+					g_get_real_time () / G_USEC_PER_SEC);
+	g_debug ("got %u new points of history, %u in total", array->len, merged->len);
+	gpm_stats_render_history (merged);
+out:
+	gpm_stats_history_request_free (request);
+}
+
+static void
+gpm_stats_update_info_page_history (UpDevice *device)
+{
+	GpmStatsHistoryRequest *request;
+	g_autoptr(GPtrArray) cached = NULL;
+	guint newest = 0;
+	guint now;
+	guint resolution;
+	guint timespan;
+
+	request = g_new0 (GpmStatsHistoryRequest, 1);
+	request->object_path = g_strdup (up_device_get_object_path (device));
+	request->type = g_strdup (history_type);
+	request->timespan = history_time;
+	request->resolution = gpm_stats_get_history_resolution ();
+	history_resolution = request->resolution;
+
+	/* show what we have straight away, then only ask for what is newer */
+	cached = gpm_history_cache_lookup (history_cache,
+					   request->object_path,
+					   request->type,
+					   request->timespan,
+					   request->resolution,
+					   &newest);
+	now = g_get_real_time () / G_USEC_PER_SEC;
+	if (cached != NULL && newest > 0 && newest < now) {
+		gpm_stats_render_history (cached);
+		request->tail = TRUE;
+		timespan = now - newest;
+
+		/* keep the same density of points as the whole range */
+		resolution = (guint) (((guint64) request->resolution * timespan) / request->timespan);
+		resolution = MAX (resolution, 1);
+	} else if (cached != NULL && newest >= now) {
+		/* already up to date */
+		gpm_stats_render_history (cached);
+		gpm_stats_history_request_free (request);
+		return;
+	} else {
+		timespan = request->timespan;
+		resolution = request->resolution;
+	}
+
+	g_debug ("requesting %u points over %us of history", resolution, timespan);
+	fetch_pending = TRUE;
+	gpm_upower_get_history_async (request->object_path,
+				      request->type, timespan, resolution,
+				      gpm_stats_restart_cancellable (&history_cancellable),
+				      gpm_stats_history_ready_cb, request);
+}
+
+static const gchar *
+gpm_stats_get_stats_kind (gboolean *use_data)
+{
+	const gchar *type = NULL;
+
+	if (g_strcmp0 (stats_type, GPM_STATS_CHARGE_DATA_VALUE) == 0) {
+		type = "charging";
+		*use_data = TRUE;
+	} else if (g_strcmp0 (stats_type, GPM_STATS_DISCHARGE_DATA_VALUE) == 0) {
+		type = "discharging";
+		*use_data = TRUE;
+	} else if (g_strcmp0 (stats_type, GPM_STATS_CHARGE_ACCURACY_VALUE) == 0) {
+		type = "charging";
+		*use_data = FALSE;
+	} else if (g_strcmp0 (stats_type, GPM_STATS_DISCHARGE_ACCURACY_VALUE) == 0) {
+		type = "discharging";
+		*use_data = FALSE;
+	} else {
+		g_assert_not_reached ();
+	}
+	return type;
+}
+
+static void
+gpm_stats_set_stats_axes (GtkWidget *graph, gboolean use_data)
+{
+	if (use_data) {
+		g_object_set (graph,
+			      "type-x", EGG_GRAPH_WIDGET_KIND_PERCENTAGE,
+			      "type-y", EGG_GRAPH_WIDGET_KIND_FACTOR,
+			      "divs-x", 10,
+			      "autorange-x", TRUE,
+			      "autorange-y", TRUE,
+			      NULL);
+	} else {
+		g_object_set (graph,
+			      "type-x", EGG_GRAPH_WIDGET_KIND_PERCENTAGE,
+			      "type-y", EGG_GRAPH_WIDGET_KIND_PERCENTAGE,
+			      "divs-x", 10,
+			      "autorange-x", TRUE,
+			      "autorange-y", TRUE,
+			      NULL);
+	}
+}
+
+/* the same items give both the profile and how accurate it is */
+static EggGraphSeries *
+gpm_stats_stats_to_series (GPtrArray *array, gboolean use_data)
+{
+	guint i;
+	UpStatsItem *item;
+	EggGraphSeries *new;
+
+	new = egg_graph_series_sized_new (array->len);
+	for (i = 0; i < array->len; i++) {
+		item = (UpStatsItem *) g_ptr_array_index (array, i);
+		egg_graph_series_append (new, i,
+					 use_data ? up_stats_item_get_value (item) :
+						    up_stats_item_get_accuracy (item),
+					 gpm_color_from_rgb (255, 0, 0));
+	}
+	return new;
+}
+
+/* redraws the last fetched statistics */
+static void
+gpm_stats_present_stats (void)
+{
+	GtkWidget *widget;
+	gboolean checked;
+	gboolean points;
+
+	if (stats_raw == NULL)
+		return;
+
+	widget = GTK_WIDGET (gtk_builder_get_object (builder, "checkbutton_smooth_stats"));
+	checked = gtk_check_button_get_active (GTK_CHECK_BUTTON (widget));
+	widget = GTK_WIDGET (gtk_builder_get_object (builder, "checkbutton_points_stats"));
+	points = gtk_check_button_get_active (GTK_CHECK_BUTTON (widget));
+
+	if (checked && stats_smoothed == NULL) {
+		sigma_smoothing = 1.1;
+		stats_smoothed = gpm_stats_update_smooth_data (stats_raw);
+	}
+
+	/* present data to graph */
+	gpm_stats_set_graph_data (graph_statistics, stats_raw,
+				  checked ? stats_smoothed : NULL, points);
+}
+
+static void
+gpm_stats_render_stats (GPtrArray *array)
+{
+	GtkWidget *widget;
+	gboolean use_data = FALSE;
+
+	gpm_stats_get_stats_kind (&use_data);
+	gpm_stats_set_stats_axes (graph_statistics, use_data);
+	g_clear_pointer (&stats_raw, egg_graph_series_unref);
+	g_clear_pointer (&stats_smoothed, egg_graph_series_unref);
+
+	gpm_stats_timing_graph_shown ();
+	widget = GTK_WIDGET (gtk_builder_get_object (builder, "label_stats_nodata"));
+	if (array == NULL || array->len == 0) {
+		/* show no data label and hide graph */
+		gtk_widget_hide (graph_statistics);
+		gtk_widget_show (widget);
+		return;
+	}
+
+	/* hide no data and show graph */
+	gtk_widget_hide (widget);
+	gtk_widget_show (graph_statistics);
+
+	stats_raw = gpm_stats_stats_to_series (array, use_data);
+	gpm_stats_present_stats ();
+}
+
+static void
+gpm_stats_stats_ready_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	GpmStatsStatsRequest *request = (GpmStatsStatsRequest *) user_data;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) array = NULL;
+
+	array = gpm_upower_get_statistics_finish (res, &error);
+	if (array == NULL) {
+		/* the user has moved on, so this is no longer wanted */
+		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			goto out;
+		g_debug ("failed to get statistics: %s", error->message);
+	} else if (!gpm_stats_cache_add (stats_cache, request->object_path,
+					 request->type, array, request->generation)) {
+		/* a refresh for the change is already on its way */
+		g_debug ("%s statistics changed while being fetched", request->type);
+	}
+	gpm_stats_render_stats (array);
+	fetch_pending = FALSE;
+	gpm_stats_prefetch_schedule ();
+out:
+	gpm_stats_stats_request_free (request);
+}
+
+static void
+gpm_stats_update_info_page_stats (UpDevice *device)
+{
+	GpmStatsStatsRequest *request;
+	g_autoptr(GPtrArray) cached = NULL;
+	const gchar *type;
+	gboolean use_data;
+
+	/* the profile and the accuracy come from the same items */
+	type = gpm_stats_get_stats_kind (&use_data);
+	cached = gpm_stats_cache_lookup (stats_cache, up_device_get_object_path (device), type);
+	if (cached != NULL) {
+		g_debug ("using cached %s statistics", type);
+		gpm_stats_render_stats (cached);
+		return;
+	}
+
+	request = g_new0 (GpmStatsStatsRequest, 1);
+	request->object_path = g_strdup (up_device_get_object_path (device));
+	request->type = g_strdup (type);
+	request->generation = gpm_stats_cache_get_generation (stats_cache, request->object_path);
+	fetch_pending = TRUE;
+	gpm_upower_get_statistics_async (request->object_path, request->type,
+					 gpm_stats_restart_cancellable (&stats_cancellable),
+					 gpm_stats_stats_ready_cb, request);
+}
+
+static void
+gpm_stats_update_info_data_page (UpDevice *device, gint page)
+{
+	/* results for another device or page are not wanted any more */
+	gpm_stats_cancel_fetches ();
+	fetch_pending = FALSE;
+
+	if (page == 0)
+		gpm_stats_update_info_page_details (device);
+	else if (page == 1)
+		gpm_stats_update_info_page_history (device);
+	else if (page == 2)
+		gpm_stats_update_info_page_stats (device);
+
+	/* runs straight away unless the page is still fetching */
+	gpm_stats_prefetch_schedule ();
+}
+
+static void
+gpm_stats_refresh_cancel (void)
+{
+	if (refresh_id != 0) {
+		g_source_remove (refresh_id);
+		refresh_id = 0;
+	}
+	g_clear_object (&refresh_device);
+	refresh_coalesced = 0;
+}
+
+static void
+gpm_stats_update_info_data (UpDevice *device)
+{
+	gint page;
+	GtkNotebook *notebook;
+	GtkWidget *page_widget;
+	gboolean has_history;
+	gboolean has_statistics;
+
+	/* this refresh supersedes anything still queued */
+	gpm_stats_refresh_cancel ();
+
+	/* get properties */
+	g_object_get (device,
+		      "has-history", &has_history,
+		      "has-statistics", &has_statistics,
+		      NULL);
+
+	notebook = GTK_NOTEBOOK (gtk_builder_get_object (builder, "notebook1"));
+
+	/* show info page */
+	page_widget = gtk_notebook_get_nth_page (notebook, 0);
+	gtk_widget_show (page_widget);
+
+	/* hide history if no support */
+	page_widget = gtk_notebook_get_nth_page (notebook, 1);
+	if (has_history)
+		gtk_widget_show (page_widget);
+	else
+		gtk_widget_hide (page_widget);
+
+	/* hide statistics if no support */
+	page_widget = gtk_notebook_get_nth_page (notebook, 2);
+	if (has_statistics)
+		gtk_widget_show (page_widget);
+	else
+		gtk_widget_hide (page_widget);
+
+	page = gtk_notebook_get_current_page (notebook);
+	gpm_stats_update_info_data_page (device, page);
+
+	return;
+}
+
+static void
+gpm_stats_set_title (GtkWindow *window, gint page_num)
+{
+	g_autofree gchar *title = NULL;
+	const gchar * const page_titles[] = {
+		/* TRANSLATORS: shown on the titlebar */
+		N_("Device Information"),
+		/* TRANSLATORS: shown on the titlebar */
+		N_("Device History"),
+		/* TRANSLATORS: shown on the titlebar */
+		N_("Device Profile"),
+	};
+
+	/* TRANSLATORS: shown on the titlebar */
+	title = g_strdup_printf ("%s - %s", _("Power Statistics"), _(page_titles[page_num]));
+	gtk_window_set_title (window, title);
+}
+
+static void
+gpm_stats_notebook_changed_cb (GtkNotebook *notebook, gpointer page, gint page_num, gpointer user_data)
+{
+	UpDevice *device;
+	GtkWidget *widget;
+
+	/* set the window title depending on the mode */
+	widget = GTK_WIDGET (gtk_builder_get_object (builder, "dialog_stats"));
+	gpm_stats_set_title (GTK_WINDOW (widget), page_num);
+
+	/* save page in gconf */
+	g_settings_set_int (settings, GPM_SETTINGS_INFO_PAGE_NUMBER, page_num);
+
+	/* the new page is fetched in full, so nothing was lost by these */
+	if (refresh_skipped > 0)
+		g_debug ("skipped %u property changes not shown on the previous page",
+			 refresh_skipped);
+	refresh_skipped = 0;
+
+	device = gpm_stats_get_device (current_device);
+	if (device == NULL)
+		return;
+	gpm_stats_update_info_data_page (device, page_num);
+}
+
+static void
+gpm_stats_history_resize_cb (GtkDrawingArea *area, gint width, gint height, gpointer user_data)
+{
+	GtkNotebook *notebook;
+	UpDevice *device;
+	guint resolution;
+	guint delta;
+
+	history_width = width;
+
+	/* only re-query once the width has changed enough to matter */
+	if (history_resolution == 0 || current_device == NULL)
+		return;
+	resolution = gpm_stats_get_history_resolution ();
+	delta = resolution > history_resolution ? resolution - history_resolution :
+						   history_resolution - resolution;
+	if (delta < history_resolution / GPM_HISTORY_RESOLUTION_THRESHOLD)
+		return;
+
+	notebook = GTK_NOTEBOOK (gtk_builder_get_object (builder, "notebook1"));
+	if (gtk_notebook_get_current_page (notebook) != 1)
+		return;
+
+	device = gpm_stats_get_device (current_device);
+	if (device == NULL)
+		return;
+	g_debug ("history resized to %ipx, was %u points now %u",
+		 width, history_resolution, resolution);
+	gpm_stats_update_info_page_history (device);
+}
+
+static void
+gpm_stats_history_zoomed_cb (GObject *object, GParamSpec *pspec, gpointer user_data)
+{
+	GtkNotebook *notebook;
+	UpDevice *device;
+
+	/* zooming out keeps the detailed copy, which the cache still serves */
+	if (!egg_graph_widget_get_zoomed (EGG_GRAPH_WIDGET (object)))
+		return;
+
+	notebook = GTK_NOTEBOOK (gtk_builder_get_object (builder, "notebook1"));
+	if (gtk_notebook_get_current_page (notebook) != 1)
+		return;
+	device = gpm_stats_get_device (current_device);
+	if (device == NULL)
+		return;
+	g_debug ("zoomed in, loading every sample of the range");
+	gpm_stats_update_info_page_history (device);
+}
+
+static void
+gpm_stats_button_update_ui (void)
+{
+	UpDevice *device;
+	device = gpm_stats_get_device (current_device);
+	if (device == NULL)
+		return;
+	gpm_stats_update_info_data (device);
+}
+
+static void
+gpm_stats_devices_treeview_clicked_cb (GtkTreeSelection *selection, gpointer user_data)
+{
+	GtkTreeModel *model;
+	GtkTreeIter iter;
+	UpDevice *device;
+
+	/* This will only work in single or browse selection mode! */
+	if (gtk_tree_selection_get_selected (selection, &model, &iter)) {
+		g_free (current_device);
+		gtk_tree_model_get (model, &iter, GPM_DEVICES_COLUMN_ID, &current_device, -1);
+
+		/* save device in gconf */
+		g_settings_set_string (settings, GPM_SETTINGS_INFO_LAST_DEVICE, current_device);
+
+		/* show transaction_id */
+		g_debug ("selected row is: %s", current_device);
+
+		device = gpm_stats_get_device (current_device);
+		if (device != NULL)
+			gpm_stats_update_info_data (device);
+
+	} else {
+		g_debug ("no row selected");
+	}
+}
+
+/* does a change to this property alter what the visible page shows */
+static gboolean
+gpm_stats_property_affects_page (const gchar *property, gint page)
+{
+	/* these decide which pages are shown at all */
+	if (g_strcmp0 (property, "has-history") == 0 ||
+	    g_strcmp0 (property, "has-statistics") == 0)
+		return TRUE;
+
+	/* the details list shows nearly every property */
+	if (page == 0)
+		return TRUE;
+
+	/* a new sample is added whenever the device is refreshed */
+	if (page == 1) {
+		if (g_strcmp0 (property, "update-time") == 0 ||
+		    g_strcmp0 (property, "state") == 0)
+			return TRUE;
+		if (g_strcmp0 (history_type, GPM_HISTORY_CHARGE_VALUE) == 0)
+			return g_strcmp0 (property, "percentage") == 0;
+		if (g_strcmp0 (history_type, GPM_HISTORY_RATE_VALUE) == 0)
+			return g_strcmp0 (property, "energy-rate") == 0;
+		if (g_strcmp0 (history_type, GPM_HISTORY_TIME_FULL_VALUE) == 0)
+			return g_strcmp0 (property, "time-to-full") == 0;
+		if (g_strcmp0 (history_type, GPM_HISTORY_TIME_EMPTY_VALUE) == 0)
+			return g_strcmp0 (property, "time-to-empty") == 0;
+		return FALSE;
+	}
+
+	/* the profile only changes at the end of a charge or discharge */
+	if (page == 2)
+		return g_strcmp0 (property, "state") == 0;
+
+	return FALSE;
+}
+
+static gboolean
+gpm_stats_refresh_cb (gpointer user_data)
+{
+	UpDevice *device;
+
+	/* steal the pending device so the refresh does not cancel itself */
+	device = g_steal_pointer (&refresh_device);
+	refresh_id = 0;
+	if (refresh_coalesced > 0)
+		g_debug ("coalesced %u property changes into one refresh", refresh_coalesced);
+	refresh_coalesced = 0;
+
+	/* the window stopped being looked at after this was scheduled */
+	if (gpm_stats_is_paused ()) {
+		refresh_paused++;
+		g_object_unref (device);
+		return G_SOURCE_REMOVE;
+	}
+
+	/* the selection may have moved on since this was scheduled */
+	if (g_strcmp0 (current_device, up_device_get_object_path (device)) == 0)
+		gpm_stats_update_info_data (device);
+	g_object_unref (device);
+	return G_SOURCE_REMOVE;
+}
+
+static void
+gpm_stats_refresh_schedule (UpDevice *device)
+{
+	guint interval;
+
+	/* already pending, so this change will be picked up too */
+	if (refresh_id != 0) {
+		refresh_coalesced++;
+		return;
+	}
+
+	/* UPower sends all changed properties in one signal, so even an idle
+	 * is enough to turn the resulting notify storm into one refresh */
+	refresh_device = g_object_ref (device);
+	interval = g_settings_get_uint (settings, GPM_SETTINGS_INFO_REFRESH_INTERVAL);
+	if (interval == 0)
+		refresh_id = g_idle_add (gpm_stats_refresh_cb, NULL);
+	else
+		refresh_id = g_timeout_add (interval, gpm_stats_refresh_cb, NULL);
+	g_source_set_name_by_id (refresh_id, "[gpm-statistics] refresh");
+}
+
+static void
+gpm_stats_device_changed_cb (UpDevice *device, GParamSpec *pspec, gpointer user_data)
+{
+	const gchar *object_path;
+	GtkNotebook *notebook;
+	gint page;
+
+	object_path = up_device_get_object_path (device);
+	if (object_path == NULL)
+		return;
+
+	/* UPower only updates the profile at the end of a charge or discharge */
+	if (g_strcmp0 (pspec->name, "state") == 0 ||
+	    g_strcmp0 (pspec->name, "has-statistics") == 0) {
+		g_debug ("statistics for %s may have changed", object_path);
+		gpm_stats_cache_invalidate (stats_cache, object_path);
+	}
+
+	if (current_device == NULL)
+		return;
+	if (g_strcmp0 (current_device, object_path) != 0)
+		return;
+
+	/* ignore anything the visible page does not show */
+	notebook = GTK_NOTEBOOK (gtk_builder_get_object (builder, "notebook1"));
+	page = gtk_notebook_get_current_page (notebook);
+	if (!gpm_stats_property_affects_page (pspec->name, page)) {
+		refresh_skipped++;
+		return;
+	}
+
+	/* picked up in one go when the window is next active */
+	if (gpm_stats_is_paused ()) {
+		refresh_paused++;
+		return;
+	}
+
+	g_debug ("changed:   %s (%s)", object_path, pspec->name);
+	gpm_stats_refresh_schedule (device);
+}
+
+static void
+gpm_stats_window_active_cb (GtkWindow *window, GParamSpec *pspec, gpointer user_data)
+{
+	UpDevice *device;
+
+	if (gpm_stats_is_paused ())
+		return;
+
+	/* catch up with everything that happened while inactive at once */
+	device = gpm_stats_get_device (current_device);
+	if (refresh_paused > 0 && device != NULL) {
+		g_debug ("window active, %u property changes while inactive need one refresh",
+			 refresh_paused);
+		gpm_stats_refresh_schedule (device);
+	}
+	refresh_paused = 0;
+	if (prefetch_deferred) {
+		prefetch_deferred = FALSE;
+		gpm_stats_prefetch_schedule ();
+	}
 }
 
 static void
@@ -1073,6 +1809,9 @@ gpm_stats_add_device (UpDevice *device)
 		      "kind", &kind,
 		      NULL);
 	g_ptr_array_add (devices, g_object_ref (device));
+	g_hash_table_insert (devices_by_path,
+			     g_strdup (up_device_get_object_path (device)),
+			     g_object_ref (device));
 	g_signal_connect (device, "notify",
 			  G_CALLBACK (gpm_stats_device_changed_cb), NULL);
 
@@ -1102,17 +1841,17 @@ gpm_stats_device_removed_cb (UpClient *_client, const gchar *object_path, gpoint
 	GtkTreeIter iter;
 	UpDevice *device_tmp;
 	gboolean ret;
-	guint i;
 
-	for (i = 0; i < devices->len; i++) {
-		device_tmp = g_ptr_array_index (devices, i);
-		if (g_strcmp0 (up_device_get_object_path (device_tmp), object_path) == 0) {
-			g_ptr_array_remove_index_fast (devices, i);
-			break;
-		}
+	device_tmp = gpm_stats_get_device (object_path);
+	if (device_tmp != NULL) {
+		g_signal_handlers_disconnect_by_func (device_tmp, gpm_stats_device_changed_cb, NULL);
+		g_ptr_array_remove (devices, device_tmp);
+		g_hash_table_remove (devices_by_path, object_path);
 	}
 
 	g_debug ("removed:   %s", object_path);
+	gpm_history_cache_invalidate (history_cache, object_path);
+	gpm_stats_cache_invalidate (stats_cache, object_path);
 	if (g_strcmp0 (current_device, object_path) == 0) {
 		gtk_list_store_clear (list_store_info);
 	}
@@ -1259,7 +1998,7 @@ gpm_stats_smooth_checkbox_history_cb (GtkWidget *widget, gpointer data)
 	gboolean checked;
 	checked = gtk_check_button_get_active (GTK_CHECK_BUTTON (widget));
 	g_settings_set_boolean (settings, GPM_SETTINGS_INFO_HISTORY_GRAPH_SMOOTH, checked);
-	gpm_stats_button_update_ui ();
+	gpm_stats_present_history ();
 }
 
 static void
@@ -1268,7 +2007,7 @@ gpm_stats_smooth_checkbox_stats_cb (GtkWidget *widget, gpointer data)
 	gboolean checked;
 	checked = gtk_check_button_get_active (GTK_CHECK_BUTTON (widget));
 	g_settings_set_boolean (settings, GPM_SETTINGS_INFO_STATS_GRAPH_SMOOTH, checked);
-	gpm_stats_button_update_ui ();
+	gpm_stats_present_stats ();
 }
 
 static void
@@ -1277,7 +2016,7 @@ gpm_stats_points_checkbox_history_cb (GtkWidget *widget, gpointer data)
 	gboolean checked;
 	checked = gtk_check_button_get_active (GTK_CHECK_BUTTON (widget));
 	g_settings_set_boolean (settings, GPM_SETTINGS_INFO_HISTORY_GRAPH_POINTS, checked);
-	gpm_stats_button_update_ui ();
+	gpm_stats_present_history ();
 }
 
 static void
@@ -1286,7 +2025,7 @@ gpm_stats_points_checkbox_stats_cb (GtkWidget *widget, gpointer data)
 	gboolean checked;
 	checked = gtk_check_button_get_active (GTK_CHECK_BUTTON (widget));
 	g_settings_set_boolean (settings, GPM_SETTINGS_INFO_STATS_GRAPH_POINTS, checked);
-	gpm_stats_button_update_ui ();
+	gpm_stats_present_stats ();
 }
 
 static gboolean
@@ -1320,6 +2059,423 @@ gpm_stats_highlight_device (const gchar *object_path)
 	return found;
 }
 
+typedef enum {
+	GPM_STATS_EXPORT_FORMAT_CSV,
+	GPM_STATS_EXPORT_FORMAT_JSON
+} GpmStatsExportFormat;
+
+/* a device to export from when none was given */
+static gchar *
+gpm_stats_export_find_device (gboolean want_history)
+{
+	UpClient *client_tmp;
+	g_autoptr(GPtrArray) devices_tmp = NULL;
+	UpDevice *device;
+	gboolean has_data;
+	gchar *object_path = NULL;
+	guint i;
+
+	client_tmp = up_client_new ();
+	if (client_tmp == NULL)
+		return NULL;
+	devices_tmp = up_client_get_devices2 (client_tmp);
+	for (i = 0; devices_tmp != NULL && i < devices_tmp->len; i++) {
+		device = g_ptr_array_index (devices_tmp, i);
+		g_object_get (device,
+			      want_history ? "has-history" : "has-statistics", &has_data,
+			      NULL);
+		if (has_data) {
+			object_path = g_strdup (up_device_get_object_path (device));
+			break;
+		}
+	}
+	g_object_unref (client_tmp);
+	return object_path;
+}
+
+static void
+gpm_stats_export_history (GPtrArray *array, GpmStatsExportFormat format)
+{
+	UpHistoryItem *item;
+	gchar value[G_ASCII_DTOSTR_BUF_SIZE];
+	const gchar *state;
+	guint i;
+
+	if (format == GPM_STATS_EXPORT_FORMAT_CSV)
+		g_print ("time,value,state\n");
+	else
+		g_print ("[");
+	for (i = 0; i < array->len; i++) {
+		item = g_ptr_array_index (array, i);
+		g_ascii_dtostr (value, sizeof (value), up_history_item_get_value (item));
+		state = up_device_state_to_string (up_history_item_get_state (item));
+		if (format == GPM_STATS_EXPORT_FORMAT_CSV) {
+			g_print ("%u,%s,%s\n", up_history_item_get_time (item), value, state);
+		} else {
+			g_print ("%s\n  {\"time\": %u, \"value\": %s, \"state\": \"%s\"}",
+				 i > 0 ? "," : "",
+				 up_history_item_get_time (item), value, state);
+		}
+	}
+	if (format == GPM_STATS_EXPORT_FORMAT_JSON)
+		g_print ("\n]\n");
+}
+
+static void
+gpm_stats_export_statistics (GPtrArray *array, GpmStatsExportFormat format)
+{
+	UpStatsItem *item;
+	gchar value[G_ASCII_DTOSTR_BUF_SIZE];
+	gchar accuracy[G_ASCII_DTOSTR_BUF_SIZE];
+	guint i;
+
+	if (format == GPM_STATS_EXPORT_FORMAT_CSV)
+		g_print ("percentage,value,accuracy\n");
+	else
+		g_print ("[");
+	for (i = 0; i < array->len; i++) {
+		item = g_ptr_array_index (array, i);
+		g_ascii_dtostr (value, sizeof (value), up_stats_item_get_value (item));
+		g_ascii_dtostr (accuracy, sizeof (accuracy), up_stats_item_get_accuracy (item));
+		if (format == GPM_STATS_EXPORT_FORMAT_CSV) {
+			g_print ("%u,%s,%s\n", i, value, accuracy);
+		} else {
+			g_print ("%s\n  {\"percentage\": %u, \"value\": %s, \"accuracy\": %s}",
+				 i > 0 ? "," : "", i, value, accuracy);
+		}
+	}
+	if (format == GPM_STATS_EXPORT_FORMAT_JSON)
+		g_print ("\n]\n");
+}
+
+/* prints the data for a device without creating any widgets */
+static gint
+gpm_stats_export (GVariantDict *options, const gchar *export_history, const gchar *export_stats)
+{
+	GpmStatsExportFormat format = GPM_STATS_EXPORT_FORMAT_CSV;
+	const gchar *format_str = NULL;
+	g_autofree gchar *object_path = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) array = NULL;
+	gint range = 0;
+	guint resolution;
+
+	if (export_history != NULL && export_stats != NULL) {
+		/* TRANSLATORS: the user asked for two things that can't be printed together */
+		g_printerr ("%s\n", _("Only one of --export-history and --export-statistics can be used"));
+		return EXIT_FAILURE;
+	}
+	if (g_variant_dict_lookup (options, "format", "&s", &format_str)) {
+		if (g_strcmp0 (format_str, "json") == 0) {
+			format = GPM_STATS_EXPORT_FORMAT_JSON;
+		} else if (g_strcmp0 (format_str, "csv") != 0) {
+			/* TRANSLATORS: the --format option was not csv or json */
+			g_printerr (_("Unknown format '%s'"), format_str);
+			g_printerr ("\n");
+			return EXIT_FAILURE;
+		}
+	}
+
+	/* the device on the command line, or the first one with data */
+	if (!g_variant_dict_lookup (options, "device", "s", &object_path))
+		object_path = gpm_stats_export_find_device (export_history != NULL);
+	if (object_path == NULL) {
+		/* TRANSLATORS: there is nothing to export */
+		g_printerr ("%s\n", _("No device has any data, use --device to choose one"));
+		return EXIT_FAILURE;
+	}
+
+	if (export_history != NULL) {
+		if (g_strcmp0 (export_history, GPM_HISTORY_RATE_VALUE) != 0 &&
+		    g_strcmp0 (export_history, GPM_HISTORY_CHARGE_VALUE) != 0 &&
+		    g_strcmp0 (export_history, GPM_HISTORY_TIME_FULL_VALUE) != 0 &&
+		    g_strcmp0 (export_history, GPM_HISTORY_TIME_EMPTY_VALUE) != 0) {
+			/* TRANSLATORS: the history type was not rate, charge, time-full or time-empty */
+			g_printerr (_("Unknown history type '%s'"), export_history);
+			g_printerr ("\n");
+			return EXIT_FAILURE;
+		}
+		if (!g_variant_dict_lookup (options, "range", "i", &range) || range <= 0)
+			range = g_settings_get_int (settings, GPM_SETTINGS_INFO_HISTORY_TIME);
+
+		/* ask for every point upowerd has stored */
+		resolution = MAX ((guint) range / GPM_HISTORY_SAMPLE_INTERVAL, GPM_HISTORY_RESOLUTION_MIN);
+		array = gpm_upower_get_history_sync (object_path, export_history,
+						     range, resolution, NULL, &error);
+		if (array == NULL) {
+			g_printerr ("%s\n", error->message);
+			return EXIT_FAILURE;
+		}
+		gpm_stats_export_history (array, format);
+	} else {
+		if (g_strcmp0 (export_stats, "charging") != 0 &&
+		    g_strcmp0 (export_stats, "discharging") != 0) {
+			/* TRANSLATORS: the statistics type was not charging or discharging */
+			g_printerr (_("Unknown statistics type '%s'"), export_stats);
+			g_printerr ("\n");
+			return EXIT_FAILURE;
+		}
+		array = gpm_upower_get_statistics_sync (object_path, export_stats, NULL, &error);
+		if (array == NULL) {
+			g_printerr ("%s\n", error->message);
+			return EXIT_FAILURE;
+		}
+		gpm_stats_export_statistics (array, format);
+	}
+	return EXIT_SUCCESS;
+}
+
+static gboolean
+gpm_stats_render_save (GtkWidget *graph, const gchar *directory, const gchar *name,
+		       gboolean use_png, GError **error)
+{
+	g_autofree gchar *basename = NULL;
+	g_autofree gchar *filename = NULL;
+	g_autoptr(GFile) file = NULL;
+	g_autoptr(GFileOutputStream) stream = NULL;
+
+	basename = g_strdup_printf ("%s.%s", name, use_png ? "png" : "svg");
+	filename = g_build_filename (directory, basename, NULL);
+	g_debug ("rendering %s", filename);
+	if (use_png) {
+		return egg_graph_widget_export_to_png (EGG_GRAPH_WIDGET (graph), filename,
+						       GPM_STATS_RENDER_WIDTH,
+						       GPM_STATS_RENDER_HEIGHT,
+						       error);
+	}
+
+	/* write straight to the file rather than building it in memory */
+	file = g_file_new_for_path (filename);
+	stream = g_file_replace (file, NULL, FALSE, G_FILE_CREATE_NONE, NULL, error);
+	if (stream == NULL)
+		return FALSE;
+	if (!egg_graph_widget_export_to_svg_stream (EGG_GRAPH_WIDGET (graph),
+						    G_OUTPUT_STREAM (stream),
+						    GPM_STATS_RENDER_WIDTH,
+						    GPM_STATS_RENDER_HEIGHT,
+						    NULL, error)) {
+		g_autoptr(GCancellable) cancellable = g_cancellable_new ();
+
+		/* closing with a cancelled cancellable leaves the old file alone */
+		g_cancellable_cancel (cancellable);
+		g_output_stream_close (G_OUTPUT_STREAM (stream), cancellable, NULL);
+		return FALSE;
+	}
+	return g_output_stream_close (G_OUTPUT_STREAM (stream), NULL, error);
+}
+
+/* only the points inside the range, so the y autorange fits what is drawn */
+static EggGraphSeries *
+gpm_stats_history_slice (const EggGraphSeries *series, gdouble start_x, gdouble stop_x)
+{
+	EggGraphSeries *slice;
+	guint first = 0;
+	guint end = series->len;
+	guint i;
+
+	/* an unsorted series is just checked point by point */
+	egg_graph_series_find_range (series, start_x, stop_x, &first, &end);
+	slice = egg_graph_series_sized_new (end - first);
+	for (i = first; i < end; i++) {
+		if (series->x[i] < start_x || series->x[i] > stop_x)
+			continue;
+		egg_graph_series_append (slice, series->x[i], series->y[i], series->color[i]);
+	}
+	return slice;
+}
+
+/* every history range from one fetch of the longest */
+static gboolean
+gpm_stats_render_history_all (GtkWidget *graph, const gchar *object_path, const gchar *id,
+			      const gchar *directory, gboolean use_png, GError **error)
+{
+	const gchar *types[] = { GPM_HISTORY_RATE_VALUE,
+				 GPM_HISTORY_CHARGE_VALUE,
+				 GPM_HISTORY_TIME_FULL_VALUE,
+				 GPM_HISTORY_TIME_EMPTY_VALUE,
+				 NULL };
+	const guint timespans[] = { GPM_HISTORY_MINUTE_VALUE,
+				    GPM_HISTORY_HOUR_VALUE,
+				    GPM_HISTORY_HOURS_VALUE,
+				    GPM_HISTORY_DAY_VALUE,
+				    GPM_HISTORY_WEEK_VALUE,
+				    0 };
+	const guint divs[] = { GPM_HISTORY_MINUTE_DIVS,
+			       GPM_HISTORY_HOUR_DIVS,
+			       GPM_HISTORY_HOURS_DIVS,
+			       GPM_HISTORY_DAY_DIVS,
+			       GPM_HISTORY_WEEK_DIVS };
+	gboolean smooth = g_settings_get_boolean (settings, GPM_SETTINGS_INFO_HISTORY_GRAPH_SMOOTH);
+	gboolean points = g_settings_get_boolean (settings, GPM_SETTINGS_INFO_HISTORY_GRAPH_POINTS);
+	gint64 now = g_get_real_time () / G_USEC_PER_SEC;
+	guint i, j;
+
+	sigma_smoothing = 2.0;
+	for (i = 0; types[i] != NULL; i++) {
+		g_autoptr(GPtrArray) array = NULL;
+		g_autoptr(EggGraphSeries) series = NULL;
+
+		array = gpm_upower_get_history_sync (object_path, types[i],
+						     GPM_HISTORY_WEEK_VALUE,
+						     GPM_HISTORY_WEEK_VALUE / GPM_HISTORY_SAMPLE_INTERVAL,
+						     NULL, error);
+		if (array == NULL)
+			return FALSE;
+		if (array->len == 0)
+			continue;
+		series = gpm_stats_history_to_series (array, types[i], now);
+		for (j = 0; timespans[j] != 0; j++) {
+			g_autofree gchar *name = NULL;
+			g_autoptr(EggGraphSeries) slice = NULL;
+			g_autoptr(EggGraphSeries) smoothed = NULL;
+
+			/* fetched once for the week, and cut down for each range */
+			slice = gpm_stats_history_slice (series, -(gdouble) timespans[j], 0.f);
+			if (smooth && slice->len > 0)
+				smoothed = gpm_stats_update_smooth_data (slice);
+			gpm_stats_set_graph_data (graph, slice, smoothed, points);
+			gpm_stats_set_history_axes (graph, types[i], timespans[j], divs[j]);
+			name = g_strdup_printf ("%s-history-%s-%u", id, types[i], timespans[j]);
+			if (!gpm_stats_render_save (graph, directory, name, use_png, error))
+				return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/* the profile and the accuracy both come from one fetch */
+static gboolean
+gpm_stats_render_stats_all (GtkWidget *graph, const gchar *object_path, const gchar *id,
+			    const gchar *directory, gboolean use_png, GError **error)
+{
+	const gchar *types[] = { "charging", "discharging", NULL };
+	const gchar *names[] = { GPM_STATS_CHARGE_DATA_VALUE,
+				 GPM_STATS_CHARGE_ACCURACY_VALUE,
+				 GPM_STATS_DISCHARGE_DATA_VALUE,
+				 GPM_STATS_DISCHARGE_ACCURACY_VALUE };
+	gboolean smooth = g_settings_get_boolean (settings, GPM_SETTINGS_INFO_STATS_GRAPH_SMOOTH);
+	gboolean points = g_settings_get_boolean (settings, GPM_SETTINGS_INFO_STATS_GRAPH_POINTS);
+	guint i, j;
+
+	sigma_smoothing = 1.1;
+	for (i = 0; types[i] != NULL; i++) {
+		g_autoptr(GPtrArray) array = NULL;
+
+		array = gpm_upower_get_statistics_sync (object_path, types[i], NULL, error);
+		if (array == NULL)
+			return FALSE;
+		if (array->len == 0)
+			continue;
+		for (j = 0; j < 2; j++) {
+			g_autoptr(EggGraphSeries) series = NULL;
+			g_autoptr(EggGraphSeries) smoothed = NULL;
+			g_autofree gchar *name = NULL;
+			series = gpm_stats_stats_to_series (array, j == 0);
+			if (smooth)
+				smoothed = gpm_stats_update_smooth_data (series);
+			gpm_stats_set_stats_axes (graph, j == 0);
+			gpm_stats_set_graph_data (graph, series, smoothed, points);
+			name = g_strdup_printf ("%s-statistics-%s", id, names[i * 2 + j]);
+			if (!gpm_stats_render_save (graph, directory, name, use_png, error))
+				return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/* draws the graphs of every device into files, without showing a window
+ * and without needing a display */
+static gint
+gpm_stats_render_all (const gchar *directory, const gchar *format)
+{
+	UpClient *client_tmp;
+	g_autoptr(GPtrArray) devices_tmp = NULL;
+	GtkWidget *graph;
+	UpDevice *device;
+	gboolean use_png = FALSE;
+	gboolean has_history;
+	gboolean has_statistics;
+	gint status = EXIT_SUCCESS;
+	guint i;
+
+	if (g_strcmp0 (format, "png") == 0) {
+		use_png = TRUE;
+	} else if (format != NULL && g_strcmp0 (format, "svg") != 0) {
+		/* TRANSLATORS: the --render-format option was not svg or png */
+		g_printerr (_("Unknown format '%s'"), format);
+		g_printerr ("\n");
+		return EXIT_FAILURE;
+	}
+	if (g_mkdir_with_parents (directory, 0755) != 0) {
+		g_printerr ("%s: %s\n", directory, g_strerror (errno));
+		return EXIT_FAILURE;
+	}
+
+	/* the graph is a widget, so this needs a display even if nothing is shown */
+	if (!gtk_init_check ()) {
+		/* TRANSLATORS: --render was used without a display to draw with */
+		g_printerr ("%s\n", _("Cannot render graphs without a display"));
+		return EXIT_FAILURE;
+	}
+
+	client_tmp = up_client_new ();
+	if (client_tmp == NULL)
+		return EXIT_FAILURE;
+	devices_tmp = up_client_get_devices2 (client_tmp);
+
+	/* one graph is drawn again and again */
+	graph = g_object_ref_sink (egg_graph_widget_new ());
+	for (i = 0; devices_tmp != NULL && i < devices_tmp->len; i++) {
+		g_autoptr(GError) error = NULL;
+		g_autofree gchar *id = NULL;
+		const gchar *object_path;
+
+		device = g_ptr_array_index (devices_tmp, i);
+		object_path = up_device_get_object_path (device);
+		g_object_get (device,
+			      "has-history", &has_history,
+			      "has-statistics", &has_statistics,
+			      NULL);
+		id = g_path_get_basename (object_path);
+		if (has_history &&
+		    !gpm_stats_render_history_all (graph, object_path, id, directory, use_png, &error)) {
+			g_printerr ("%s: %s\n", object_path, error->message);
+			status = EXIT_FAILURE;
+			continue;
+		}
+		if (has_statistics &&
+		    !gpm_stats_render_stats_all (graph, object_path, id, directory, use_png, &error)) {
+			g_printerr ("%s: %s\n", object_path, error->message);
+			status = EXIT_FAILURE;
+		}
+	}
+	g_object_unref (graph);
+	g_object_unref (client_tmp);
+	return status;
+}
+
+static gint
+gpm_stats_handle_local_options_cb (GApplication *application,
+				   GVariantDict *options,
+				   gpointer user_data)
+{
+	const gchar *export_history = NULL;
+	const gchar *export_stats = NULL;
+	const gchar *render = NULL;
+	const gchar *render_format = NULL;
+
+	/* rendering and exporting never talk to the running instance */
+	if (g_variant_dict_lookup (options, "render", "^&ay", &render)) {
+		g_variant_dict_lookup (options, "render-format", "&s", &render_format);
+		return gpm_stats_render_all (render, render_format);
+	}
+	g_variant_dict_lookup (options, "export-history", "&s", &export_history);
+	g_variant_dict_lookup (options, "export-statistics", "&s", &export_stats);
+	if (export_history == NULL && export_stats == NULL)
+		return -1;
+	return gpm_stats_export (options, export_history, export_stats);
+}
+
 static int
 gpm_stats_commandline_cb (GApplication *application,
 			  GApplicationCommandLine *cmdline,
@@ -1332,16 +2488,24 @@ gpm_stats_commandline_cb (GApplication *application,
 	/* read command line options */
 	options = g_application_command_line_get_options_dict (cmdline);
 	g_variant_dict_lookup (options, "device", "s", &last_device);
+	g_variant_dict_lookup (options, "timing", "b", &startup_timing);
 
 	/* get from GSettings if we never specified on the command line */
 	if (last_device == NULL)
 		last_device = g_settings_get_string (settings, GPM_SETTINGS_INFO_LAST_DEVICE);
 
+	/* the devices are added once the window is showing, which then
+	 * selects this one */
+	if (client == NULL) {
+		g_free (startup_device);
+		startup_device = g_steal_pointer (&last_device);
+	}
+
 	/* make sure the window is raised */
 	g_application_activate (application);
 
 	/* set the correct focus on the last device */
-	if (last_device != NULL) {
+	if (last_device != NULL && client != NULL) {
 		ret = gpm_stats_highlight_device (last_device);
 		if (!ret) {
 			g_warning ("failed to select");
@@ -1352,6 +2516,73 @@ gpm_stats_commandline_cb (GApplication *application,
 	return TRUE;
 }
 
+/* selects a row, which fetches the data for the page that is showing */
+static void
+gpm_stats_select_first_device (void)
+{
+	GtkTreePath *path;
+	GtkWidget *widget;
+
+	if (startup_device != NULL && startup_device[0] != '\0' &&
+	    gpm_stats_highlight_device (startup_device))
+		return;
+	if (devices->len == 0)
+		return;
+	path = gtk_tree_path_new_first ();
+	widget = GTK_WIDGET (gtk_builder_get_object (builder, "treeview_devices"));
+	gtk_tree_view_set_cursor_on_cell (GTK_TREE_VIEW (widget), path, NULL, NULL, FALSE);
+	gtk_tree_path_free (path);
+}
+
+static void
+gpm_stats_coldplug (void)
+{
+	GPtrArray *devices_tmp;
+	UpDevice *device;
+	UpDeviceKind kind;
+	guint i, j;
+
+	client = up_client_new ();
+	if (client == NULL) {
+		g_warning ("failed to connect to upower");
+		return;
+	}
+	devices_tmp = up_client_get_devices2 (client);
+	g_signal_connect (client, "device-added", G_CALLBACK (gpm_stats_device_added_cb), NULL);
+	g_signal_connect (client, "device-removed", G_CALLBACK (gpm_stats_device_removed_cb), NULL);
+
+	/* add devices in visually pleasing order */
+	for (j=0; j<UP_DEVICE_KIND_LAST; j++) {
+		for (i=0; i < devices_tmp->len; i++) {
+			device = g_ptr_array_index (devices_tmp, i);
+			g_object_get (device, "kind", &kind, NULL);
+			if (kind == j)
+				gpm_stats_add_device (device);
+		}
+	}
+	g_ptr_array_unref (devices_tmp);
+
+	/* the one and only fetch at startup */
+	gpm_stats_select_first_device ();
+	g_clear_pointer (&startup_device, g_free);
+}
+
+static gboolean
+gpm_stats_coldplug_cb (gpointer user_data)
+{
+	gpm_stats_coldplug ();
+	return G_SOURCE_REMOVE;
+}
+
+/* the empty window is on screen, so now it is worth talking to upower */
+static void
+gpm_stats_after_paint_cb (GdkFrameClock *frame_clock, gpointer user_data)
+{
+	g_signal_handlers_disconnect_by_func (frame_clock, gpm_stats_after_paint_cb, user_data);
+	gpm_stats_timing_report ("Time to first frame");
+	gpm_stats_coldplug ();
+}
+
 static void
 gpm_stats_activate_cb (GApplication *application,
 		       gpointer user_data)
@@ -1360,10 +2591,7 @@ gpm_stats_activate_cb (GApplication *application,
 	GtkWidget *widget;
 	GtkWindow *window;
 	GtkTreeSelection *selection;
-	GPtrArray *devices_tmp;
-	UpDevice *device;
-	UpDeviceKind kind;
-	guint i, j;
+	GdkFrameClock *frame_clock;
 	gint page;
 	gboolean checked;
 	guint retval;
@@ -1376,8 +2604,18 @@ gpm_stats_activate_cb (GApplication *application,
 		return;
 	}
 
+	/* add application specific icons to search path */
+	gtk_icon_theme_add_search_path (gtk_icon_theme_get_for_display (gdk_display_get_default ()),
+					DATADIR G_DIR_SEPARATOR_S
+					"gnome-power-manager" G_DIR_SEPARATOR_S
+					"icons");
+
 	/* a store of UpDevices */
 	devices = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	devices_by_path = g_hash_table_new_full (g_str_hash, g_str_equal,
+						 g_free, (GDestroyNotify) g_object_unref);
+	history_cache = gpm_history_cache_new ();
+	stats_cache = gpm_stats_cache_new ();
 
 	/* Ensure types */
 	g_type_ensure (GPM_TYPE_ROTATED_WIDGET);
@@ -1397,6 +2635,10 @@ gpm_stats_activate_cb (GApplication *application,
 	graph_history = egg_graph_widget_new ();
 	gtk_box_append (box, graph_history);
 	gtk_widget_set_size_request (graph_history, 400, 250);
+	g_signal_connect (graph_history, "resize",
+			  G_CALLBACK (gpm_stats_history_resize_cb), NULL);
+	g_signal_connect (graph_history, "notify::zoomed",
+			  G_CALLBACK (gpm_stats_history_zoomed_cb), NULL);
 	gtk_widget_show (graph_history);
 
 	/* add statistics graph */
@@ -1532,38 +2774,24 @@ gpm_stats_activate_cb (GApplication *application,
 	g_signal_connect (G_OBJECT (widget), "changed",
 			  G_CALLBACK (gpm_stats_range_combo_changed), NULL);
 
-	/* coldplug */
-	client = up_client_new ();
-	devices_tmp = up_client_get_devices2 (client);
-	g_signal_connect (client, "device-added", G_CALLBACK (gpm_stats_device_added_cb), NULL);
-	g_signal_connect (client, "device-removed", G_CALLBACK (gpm_stats_device_removed_cb), NULL);
-
-	/* add devices in visually pleasing order */
-	for (j=0; j<UP_DEVICE_KIND_LAST; j++) {
-		for (i=0; i < devices_tmp->len; i++) {
-			device = g_ptr_array_index (devices_tmp, i);
-			g_object_get (device, "kind", &kind, NULL);
-			if (kind == j)
-				gpm_stats_add_device (device);
-		}
-	}
-
-	/* set current device */
-	if (devices->len > 0) {
-		device = g_ptr_array_index (devices, 0);
-		gpm_stats_update_info_data (device);
-		current_device = g_strdup (up_device_get_object_path (device));
-	}
-
-	/* set axis */
+	/* set axis, which fetches nothing as there is no device yet */
 	widget = GTK_WIDGET (gtk_builder_get_object (builder, "combobox_history_type"));
 	gpm_stats_history_type_combo_changed_cb (widget, NULL);
 	widget = GTK_WIDGET (gtk_builder_get_object (builder, "combobox_stats_type"));
 	gpm_stats_type_combo_changed_cb (widget, NULL);
 
+	/* show the window straight away, and add the devices after */
 	widget = GTK_WIDGET (gtk_builder_get_object (builder, "dialog_stats"));
+	g_signal_connect (widget, "notify::is-active",
+			  G_CALLBACK (gpm_stats_window_active_cb), NULL);
 	gtk_widget_show (widget);
-	g_ptr_array_unref (devices_tmp);
+	frame_clock = gtk_widget_get_frame_clock (widget);
+	if (frame_clock != NULL) {
+		g_signal_connect (frame_clock, "after-paint",
+				  G_CALLBACK (gpm_stats_after_paint_cb), NULL);
+	} else {
+		g_idle_add (gpm_stats_coldplug_cb, NULL);
+	}
 }
 
 int
@@ -1576,17 +2804,37 @@ main (int argc, char *argv[])
 		{ "device", '\0', 0, G_OPTION_ARG_STRING, NULL,
 		  /* TRANSLATORS: show a device by default */
 		  N_("Select this device at startup"), NULL },
+		{ "export-history", '\0', 0, G_OPTION_ARG_STRING, NULL,
+		  /* TRANSLATORS: print the history instead of showing the window */
+		  N_("Print the history of the device and exit"), "rate|charge|time-full|time-empty" },
+		{ "export-statistics", '\0', 0, G_OPTION_ARG_STRING, NULL,
+		  /* TRANSLATORS: print the statistics instead of showing the window */
+		  N_("Print the statistics of the device and exit"), "charging|discharging" },
+		{ "range", '\0', 0, G_OPTION_ARG_INT, NULL,
+		  /* TRANSLATORS: how much history to print */
+		  N_("The number of seconds of history to print"), N_("SECONDS") },
+		{ "format", '\0', 0, G_OPTION_ARG_STRING, NULL,
+		  /* TRANSLATORS: how the history or statistics are printed */
+		  N_("The format to print in"), "csv|json" },
+		{ "timing", '\0', 0, G_OPTION_ARG_NONE, NULL,
+		  /* TRANSLATORS: print how long the window took to start */
+		  N_("Show how long it takes to show the window and the first graph"), NULL },
+		{ "render", '\0', 0, G_OPTION_ARG_FILENAME, NULL,
+		  /* TRANSLATORS: draw the graphs to files instead of showing the window */
+		  N_("Save the graphs of every device to a directory and exit"), N_("DIRECTORY") },
+		{ "render-format", '\0', 0, G_OPTION_ARG_STRING, NULL,
+		  /* TRANSLATORS: the type of image the graphs are saved as */
+		  N_("The format to save the graphs in"), "svg|png" },
 		{ NULL}
 	};
 
+	startup_time = g_get_monotonic_time ();
 	setlocale (LC_ALL, "");
 
 	bindtextdomain (GETTEXT_PACKAGE, LOCALEDIR);
 	bind_textdomain_codeset (GETTEXT_PACKAGE, "UTF-8");
 	textdomain (GETTEXT_PACKAGE);
 
-	gtk_init ();
-
 	/* get data from gconf */
 	settings = g_settings_new (GPM_SETTINGS_SCHEMA);
 
@@ -1598,24 +2846,41 @@ main (int argc, char *argv[])
 	g_signal_connect (application, "command-line",
 			  G_CALLBACK (gpm_stats_commandline_cb), NULL);
 
+	/* exports run from here and exit before GtkApplication opens the
+	 * display at startup */
+	g_signal_connect (application, "handle-local-options",
+			  G_CALLBACK (gpm_stats_handle_local_options_cb), NULL);
+
 	g_application_add_main_option_entries (G_APPLICATION (application), options);
 	g_application_set_option_context_summary (G_APPLICATION (application),
 	                                          /* TRANSLATORS: the program name */
 	                                          _("Power Statistics"));
 
-	/* add application specific icons to search path */
-	gtk_icon_theme_add_search_path (gtk_icon_theme_get_for_display (gdk_display_get_default ()),
-					DATADIR G_DIR_SEPARATOR_S
-					"gnome-power-manager" G_DIR_SEPARATOR_S
-					"icons");
-
 	/* run */
 	status = g_application_run (G_APPLICATION (application), argc, argv);
 
+	gpm_stats_refresh_cancel ();
+	gpm_stats_cancel_fetches ();
+	if (prefetch_id != 0)
+		g_source_remove (prefetch_id);
+	if (prefetch_cancellable != NULL)
+		g_cancellable_cancel (prefetch_cancellable);
+	g_clear_object (&history_cancellable);
+	g_clear_object (&stats_cancellable);
+	g_clear_object (&prefetch_cancellable);
 	if (client != NULL)
 		g_object_unref (client);
 	if (devices != NULL)
 		g_ptr_array_unref (devices);
+	if (devices_by_path != NULL)
+		g_hash_table_unref (devices_by_path);
+	gpm_history_cache_free (history_cache);
+	gpm_stats_cache_free (stats_cache);
+	g_clear_pointer (&history_raw, egg_graph_series_unref);
+	g_clear_pointer (&history_smoothed, egg_graph_series_unref);
+	g_clear_pointer (&stats_raw, egg_graph_series_unref);
+	g_clear_pointer (&stats_smoothed, egg_graph_series_unref);
+	g_free (startup_device);
 	g_object_unref (settings);
 	return status;
 }
@@ -0,0 +1,156 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The GNOME Power Manager authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+
+#include "gpm-stats-cache.h"
+
+struct _GpmStatsCache
+{
+	GHashTable	*entries;	/* key: object path, value: GHashTable */
+	GHashTable	*generations;	/* key: object path, value: guint */
+};
+
+/**
+ * gpm_stats_cache_new:
+ *
+ * Creates a cache of device statistics, keyed by the device object path
+ * and the direction, i.e. "charging" or "discharging". Each array holds
+ * both the profile and the accuracy, so one entry serves two graphs.
+ **/
+GpmStatsCache *
+gpm_stats_cache_new (void)
+{
+	GpmStatsCache *cache;
+	cache = g_new0 (GpmStatsCache, 1);
+	cache->entries = g_hash_table_new_full (g_str_hash, g_str_equal,
+						g_free, (GDestroyNotify) g_hash_table_unref);
+	cache->generations = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	return cache;
+}
+
+void
+gpm_stats_cache_free (GpmStatsCache *cache)
+{
+	if (cache == NULL)
+		return;
+	g_hash_table_unref (cache->entries);
+	g_hash_table_unref (cache->generations);
+	g_free (cache);
+}
+
+/**
+ * gpm_stats_cache_lookup:
+ *
+ * Gets the cached statistics for one direction of the device.
+ *
+ * Return value: (transfer container): an array of #UpStatsItem, or %NULL
+ **/
+GPtrArray *
+gpm_stats_cache_lookup (GpmStatsCache *cache,
+			const gchar *object_path,
+			const gchar *type)
+{
+	GHashTable *device;
+	GPtrArray *items;
+
+	g_return_val_if_fail (cache != NULL, NULL);
+
+	device = g_hash_table_lookup (cache->entries, object_path);
+	if (device == NULL)
+		return NULL;
+	items = g_hash_table_lookup (device, type);
+	if (items == NULL)
+		return NULL;
+	return g_ptr_array_ref (items);
+}
+
+/**
+ * gpm_stats_cache_get_generation:
+ *
+ * Gets a number that changes whenever the device is invalidated. Take it
+ * before asking UPower, and pass it to gpm_stats_cache_add() with the
+ * reply.
+ **/
+guint
+gpm_stats_cache_get_generation (GpmStatsCache *cache, const gchar *object_path)
+{
+	g_return_val_if_fail (cache != NULL, 0);
+	return GPOINTER_TO_UINT (g_hash_table_lookup (cache->generations, object_path));
+}
+
+/**
+ * gpm_stats_cache_add:
+ * @items: the statistics returned by UPower
+ * @generation: from gpm_stats_cache_get_generation() before the request
+ *
+ * Stores the statistics, replacing anything cached for the direction.
+ * Statistics requested before the device was last invalidated may be out
+ * of date, so they are not stored.
+ *
+ * Return value: %TRUE if the statistics were stored
+ **/
+gboolean
+gpm_stats_cache_add (GpmStatsCache *cache,
+		     const gchar *object_path,
+		     const gchar *type,
+		     GPtrArray *items,
+		     guint generation)
+{
+	GHashTable *device;
+
+	g_return_val_if_fail (cache != NULL, FALSE);
+	g_return_val_if_fail (items != NULL, FALSE);
+
+	if (generation != gpm_stats_cache_get_generation (cache, object_path))
+		return FALSE;
+
+	device = g_hash_table_lookup (cache->entries, object_path);
+	if (device == NULL) {
+		device = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+						(GDestroyNotify) g_ptr_array_unref);
+		g_hash_table_insert (cache->entries, g_strdup (object_path), device);
+	}
+	g_hash_table_insert (device, g_strdup (type), g_ptr_array_ref (items));
+	return TRUE;
+}
+
+/**
+ * gpm_stats_cache_invalidate:
+ *
+ * Forgets everything cached for the device, e.g. when it has finished
+ * charging or discharging and UPower has updated the profile.
+ **/
+void
+gpm_stats_cache_invalidate (GpmStatsCache *cache, const gchar *object_path)
+{
+	guint generation;
+
+	g_return_if_fail (cache != NULL);
+	g_hash_table_remove (cache->entries, object_path);
+
+	/* anything still in flight was asked for before this */
+	generation = gpm_stats_cache_get_generation (cache, object_path) + 1;
+	g_hash_table_insert (cache->generations, g_strdup (object_path),
+			     GUINT_TO_POINTER (generation));
+}
@@ -0,0 +1,50 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The GNOME Power Manager authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __GPM_STATS_CACHE_H
+#define __GPM_STATS_CACHE_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GpmStatsCache GpmStatsCache;
+
+GpmStatsCache	*gpm_stats_cache_new			(void);
+void		 gpm_stats_cache_free			(GpmStatsCache		*cache);
+GPtrArray	*gpm_stats_cache_lookup			(GpmStatsCache		*cache,
+							 const gchar		*object_path,
+							 const gchar		*type);
+guint		 gpm_stats_cache_get_generation		(GpmStatsCache		*cache,
+							 const gchar		*object_path);
+gboolean	 gpm_stats_cache_add			(GpmStatsCache		*cache,
+							 const gchar		*object_path,
+							 const gchar		*type,
+							 GPtrArray		*items,
+							 guint			 generation);
+void		 gpm_stats_cache_invalidate		(GpmStatsCache		*cache,
+							 const gchar		*object_path);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (GpmStatsCache, gpm_stats_cache_free)
+
+G_END_DECLS
+
+#endif /* __GPM_STATS_CACHE_H */
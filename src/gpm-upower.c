@@ -0,0 +1,360 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The GNOME Power Manager authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <gio/gio.h>
+#include <libupower-glib/upower.h>
+
+#include "gpm-upower.h"
+
+/* libupower only has blocking versions of these that need an UpDevice, so
+ * call the methods ourselves and build the same item arrays from the reply */
+#define GPM_UPOWER_DBUS_SERVICE		"org.freedesktop.UPower"
+#define GPM_UPOWER_DBUS_INTERFACE_DEVICE	"org.freedesktop.UPower.Device"
+
+typedef struct {
+	gchar			*object_path;
+	gchar			*method;
+	GVariant		*parameters;
+	const GVariantType	*reply_type;
+	GAsyncReadyCallback	 call_cb;
+	GTask			*task;
+} GpmUpowerCall;
+
+static void
+gpm_upower_call_free (GpmUpowerCall *call)
+{
+	g_free (call->object_path);
+	g_free (call->method);
+	g_variant_unref (call->parameters);
+	g_free (call);
+}
+
+static void
+gpm_upower_call_bus_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	GpmUpowerCall *call = (GpmUpowerCall *) user_data;
+	g_autoptr(GDBusConnection) connection = NULL;
+	GError *error = NULL;
+
+	connection = g_bus_get_finish (res, &error);
+	if (connection == NULL) {
+		g_task_return_error (call->task, error);
+		g_object_unref (call->task);
+		goto out;
+	}
+	g_dbus_connection_call (connection,
+				GPM_UPOWER_DBUS_SERVICE,
+				call->object_path,
+				GPM_UPOWER_DBUS_INTERFACE_DEVICE,
+				call->method,
+				call->parameters,
+				call->reply_type,
+				G_DBUS_CALL_FLAGS_NONE,
+				-1,
+				g_task_get_cancellable (call->task),
+				call->call_cb,
+				call->task);
+out:
+	gpm_upower_call_free (call);
+}
+
+static void
+gpm_upower_call (const gchar *object_path,
+		 const gchar *method,
+		 GVariant *parameters,
+		 const GVariantType *reply_type,
+		 GAsyncReadyCallback call_cb,
+		 GTask *task)
+{
+	GpmUpowerCall *call;
+
+	call = g_new0 (GpmUpowerCall, 1);
+	call->object_path = g_strdup (object_path);
+	call->method = g_strdup (method);
+	call->parameters = g_variant_ref_sink (parameters);
+	call->reply_type = reply_type;
+	call->call_cb = call_cb;
+	call->task = task;
+
+	/* this completes straight away once UpClient has set up the shared
+	 * connection, but must never block the main loop when it has not */
+	g_bus_get (G_BUS_TYPE_SYSTEM,
+		   g_task_get_cancellable (task),
+		   gpm_upower_call_bus_cb,
+		   call);
+}
+
+static GVariant *
+gpm_upower_call_sync (const gchar *object_path,
+		      const gchar *method,
+		      GVariant *parameters,
+		      const GVariantType *reply_type,
+		      GCancellable *cancellable,
+		      GError **error)
+{
+	g_autoptr(GDBusConnection) connection = NULL;
+
+	connection = g_bus_get_sync (G_BUS_TYPE_SYSTEM, cancellable, error);
+	if (connection == NULL) {
+		g_variant_unref (g_variant_ref_sink (parameters));
+		return NULL;
+	}
+	return g_dbus_connection_call_sync (connection,
+					    GPM_UPOWER_DBUS_SERVICE,
+					    object_path,
+					    GPM_UPOWER_DBUS_INTERFACE_DEVICE,
+					    method,
+					    parameters,
+					    reply_type,
+					    G_DBUS_CALL_FLAGS_NONE,
+					    -1,
+					    cancellable,
+					    error);
+}
+
+static GPtrArray *
+gpm_upower_history_from_reply (GVariant *reply)
+{
+	GPtrArray *array;
+	GVariantIter *iter;
+	UpHistoryItem *item;
+	guint32 timestamp;
+	guint32 state;
+	gdouble value;
+
+	g_variant_get (reply, "(a(udu))", &iter);
+	array = g_ptr_array_new_full (g_variant_iter_n_children (iter),
+				      (GDestroyNotify) g_object_unref);
+	while (g_variant_iter_next (iter, "(udu)", &timestamp, &value, &state)) {
+		item = up_history_item_new ();
+		up_history_item_set_time (item, timestamp);
+		up_history_item_set_value (item, value);
+		up_history_item_set_state (item, state);
+		g_ptr_array_add (array, item);
+	}
+	g_variant_iter_free (iter);
+	return array;
+}
+
+static void
+gpm_upower_get_history_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	GTask *task = G_TASK (user_data);
+	GError *error = NULL;
+	g_autoptr(GVariant) reply = NULL;
+
+	reply = g_dbus_connection_call_finish (G_DBUS_CONNECTION (source), res, &error);
+	if (reply == NULL) {
+		g_task_return_error (task, error);
+		g_object_unref (task);
+		return;
+	}
+	g_task_return_pointer (task, gpm_upower_history_from_reply (reply),
+			       (GDestroyNotify) g_ptr_array_unref);
+	g_object_unref (task);
+}
+
+/**
+ * gpm_upower_get_history_sync:
+ * @object_path: the UPower device object path
+ * @type: the history type, e.g. "charge" or "rate"
+ * @timespan: how far back to go, in seconds
+ * @resolution: the maximum number of points to return
+ *
+ * Gets the history of a device, blocking until upowerd replies. This is
+ * only for when there is no main loop running.
+ *
+ * Return value: (transfer container): an array of #UpHistoryItem, or %NULL
+ **/
+GPtrArray *
+gpm_upower_get_history_sync (const gchar *object_path,
+			     const gchar *type,
+			     guint timespan,
+			     guint resolution,
+			     GCancellable *cancellable,
+			     GError **error)
+{
+	g_autoptr(GVariant) reply = NULL;
+
+	g_return_val_if_fail (object_path != NULL, NULL);
+	g_return_val_if_fail (type != NULL, NULL);
+
+	reply = gpm_upower_call_sync (object_path, "GetHistory",
+				      g_variant_new ("(suu)", type, timespan, resolution),
+				      G_VARIANT_TYPE ("(a(udu))"),
+				      cancellable, error);
+	if (reply == NULL)
+		return NULL;
+	return gpm_upower_history_from_reply (reply);
+}
+
+/**
+ * gpm_upower_get_history_async:
+ * @object_path: the UPower device object path
+ * @type: the history type, e.g. "charge" or "rate"
+ * @timespan: how far back to go, in seconds
+ * @resolution: the maximum number of points to return
+ *
+ * Gets the history of a device without blocking.
+ **/
+void
+gpm_upower_get_history_async (const gchar *object_path,
+			      const gchar *type,
+			      guint timespan,
+			      guint resolution,
+			      GCancellable *cancellable,
+			      GAsyncReadyCallback callback,
+			      gpointer user_data)
+{
+	GTask *task;
+
+	g_return_if_fail (object_path != NULL);
+	g_return_if_fail (type != NULL);
+
+	task = g_task_new (NULL, cancellable, callback, user_data);
+	g_task_set_source_tag (task, gpm_upower_get_history_async);
+	gpm_upower_call (object_path, "GetHistory",
+			 g_variant_new ("(suu)", type, timespan, resolution),
+			 G_VARIANT_TYPE ("(a(udu))"),
+			 gpm_upower_get_history_cb, task);
+}
+
+/**
+ * gpm_upower_get_history_finish:
+ *
+ * Return value: (transfer container): an array of #UpHistoryItem, or %NULL
+ **/
+GPtrArray *
+gpm_upower_get_history_finish (GAsyncResult *res, GError **error)
+{
+	g_return_val_if_fail (g_task_is_valid (res, NULL), NULL);
+	return g_task_propagate_pointer (G_TASK (res), error);
+}
+
+static GPtrArray *
+gpm_upower_statistics_from_reply (GVariant *reply)
+{
+	GPtrArray *array;
+	GVariantIter *iter;
+	UpStatsItem *item;
+	gdouble value;
+	gdouble accuracy;
+
+	g_variant_get (reply, "(a(dd))", &iter);
+	array = g_ptr_array_new_full (g_variant_iter_n_children (iter),
+				      (GDestroyNotify) g_object_unref);
+	while (g_variant_iter_next (iter, "(dd)", &value, &accuracy)) {
+		item = up_stats_item_new ();
+		up_stats_item_set_value (item, value);
+		up_stats_item_set_accuracy (item, accuracy);
+		g_ptr_array_add (array, item);
+	}
+	g_variant_iter_free (iter);
+	return array;
+}
+
+static void
+gpm_upower_get_statistics_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	GTask *task = G_TASK (user_data);
+	GError *error = NULL;
+	g_autoptr(GVariant) reply = NULL;
+
+	reply = g_dbus_connection_call_finish (G_DBUS_CONNECTION (source), res, &error);
+	if (reply == NULL) {
+		g_task_return_error (task, error);
+		g_object_unref (task);
+		return;
+	}
+	g_task_return_pointer (task, gpm_upower_statistics_from_reply (reply),
+			       (GDestroyNotify) g_ptr_array_unref);
+	g_object_unref (task);
+}
+
+/**
+ * gpm_upower_get_statistics_sync:
+ * @object_path: the UPower device object path
+ * @type: the statistics type, either "charging" or "discharging"
+ *
+ * Gets the statistics of a device, blocking until upowerd replies.
+ *
+ * Return value: (transfer container): an array of #UpStatsItem, or %NULL
+ **/
+GPtrArray *
+gpm_upower_get_statistics_sync (const gchar *object_path,
+				const gchar *type,
+				GCancellable *cancellable,
+				GError **error)
+{
+	g_autoptr(GVariant) reply = NULL;
+
+	g_return_val_if_fail (object_path != NULL, NULL);
+	g_return_val_if_fail (type != NULL, NULL);
+
+	reply = gpm_upower_call_sync (object_path, "GetStatistics",
+				      g_variant_new ("(s)", type),
+				      G_VARIANT_TYPE ("(a(dd))"),
+				      cancellable, error);
+	if (reply == NULL)
+		return NULL;
+	return gpm_upower_statistics_from_reply (reply);
+}
+
+/**
+ * gpm_upower_get_statistics_async:
+ * @object_path: the UPower device object path
+ * @type: the statistics type, either "charging" or "discharging"
+ *
+ * Gets the statistics of a device without blocking.
+ **/
+void
+gpm_upower_get_statistics_async (const gchar *object_path,
+				 const gchar *type,
+				 GCancellable *cancellable,
+				 GAsyncReadyCallback callback,
+				 gpointer user_data)
+{
+	GTask *task;
+
+	g_return_if_fail (object_path != NULL);
+	g_return_if_fail (type != NULL);
+
+	task = g_task_new (NULL, cancellable, callback, user_data);
+	g_task_set_source_tag (task, gpm_upower_get_statistics_async);
+	gpm_upower_call (object_path, "GetStatistics",
+			 g_variant_new ("(s)", type),
+			 G_VARIANT_TYPE ("(a(dd))"),
+			 gpm_upower_get_statistics_cb, task);
+}
+
+/**
+ * gpm_upower_get_statistics_finish:
+ *
+ * Return value: (transfer container): an array of #UpStatsItem, or %NULL
+ **/
+GPtrArray *
+gpm_upower_get_statistics_finish (GAsyncResult *res, GError **error)
+{
+	g_return_val_if_fail (g_task_is_valid (res, NULL), NULL);
+	return g_task_propagate_pointer (G_TASK (res), error);
+}
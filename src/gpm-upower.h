@@ -0,0 +1,58 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 The GNOME Power Manager authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __GPM_UPOWER_H
+#define __GPM_UPOWER_H
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+void		 gpm_upower_get_history_async		(const gchar		*object_path,
+							 const gchar		*type,
+							 guint			 timespan,
+							 guint			 resolution,
+							 GCancellable		*cancellable,
+							 GAsyncReadyCallback	 callback,
+							 gpointer		 user_data);
+GPtrArray	*gpm_upower_get_history_finish		(GAsyncResult		*res,
+							 GError			**error);
+void		 gpm_upower_get_statistics_async	(const gchar		*object_path,
+							 const gchar		*type,
+							 GCancellable		*cancellable,
+							 GAsyncReadyCallback	 callback,
+							 gpointer		 user_data);
+GPtrArray	*gpm_upower_get_statistics_finish	(GAsyncResult		*res,
+							 GError			**error);
+GPtrArray	*gpm_upower_get_history_sync		(const gchar		*object_path,
+							 const gchar		*type,
+							 guint			 timespan,
+							 guint			 resolution,
+							 GCancellable		*cancellable,
+							 GError			**error);
+GPtrArray	*gpm_upower_get_statistics_sync		(const gchar		*object_path,
+							 const gchar		*type,
+							 GCancellable		*cancellable,
+							 GError			**error);
+
+G_END_DECLS
+
+#endif /* __GPM_UPOWER_H */